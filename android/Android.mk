@@ -16,14 +16,53 @@ LOCAL_SRC_FILES := \
     geometry.hpp \
     stb_vorbis.cpp \
     stb_vorbis.hpp \
+    asset_pack.cpp \
+    asset_pack.hpp \
+    atlas_format.cpp \
+    atlas_format.hpp \
     audio.cpp \
     audio.hpp \
+    bench_scene.cpp \
+    bench_scene.hpp \
     font.cpp \
     font.hpp \
     gl_helper.cpp \
     gl_helper.hpp \
+    glyph_cache.cpp \
+    glyph_cache.hpp \
+    glyph_table.cpp \
+    glyph_table.hpp \
+    headless.cpp \
+    headless.hpp \
+    hud.cpp \
+    hud.hpp \
+    layer_cache.cpp \
+    layer_cache.hpp \
     log.hpp \
-	color_palette.hpp 
+    msdf.cpp \
+    msdf.hpp \
+    profiler.cpp \
+    profiler.hpp \
+    render_thread.cpp \
+    render_thread.hpp \
+    shader_cache.cpp \
+    shader_cache.hpp \
+    shape_batch.cpp \
+    shape_batch.hpp \
+	color_palette.hpp \
+    task_graph.cpp \
+    task_graph.hpp \
+    tessellate.cpp \
+    tessellate.hpp \
+    text_batch.cpp \
+    text_batch.hpp \
+    trace.cpp \
+    trace.hpp \
+    triple_buffer.hpp \
+    truetype.cpp \
+    truetype.hpp \
+    vfs.cpp \
+    vfs.hpp
  
 SDL_PATH := ../SDL  # SDL \
 
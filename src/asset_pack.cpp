@@ -0,0 +1,304 @@
+#include "asset_pack.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr int HASH_BITS = 14;
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+
+// enough for any asset set, keeps a corrupt count from overflowing the index size
+constexpr uint32_t MAX_ENTRIES = 1 << 16;
+
+uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void write_length(std::vector<uint8_t> &out, size_t extra) {
+    while (extra >= 255) {
+        out.push_back(255);
+        extra -= 255;
+    }
+
+    out.push_back(static_cast<uint8_t>(extra));
+}
+
+void write_sequence(std::vector<uint8_t> &out,
+                    const uint8_t *literals,
+                    size_t literal_size,
+                    size_t offset,
+                    size_t match_size) {
+    size_t lit = std::min<size_t>(literal_size, 15);
+    size_t match = match_size ? std::min<size_t>(match_size - MIN_MATCH, 15) : 0;
+
+    out.push_back(static_cast<uint8_t>(lit << 4 | match));
+
+    if (lit == 15) {
+        write_length(out, literal_size - 15);
+    }
+
+    out.insert(out.end(), literals, literals + literal_size);
+
+    if (match_size == 0) {
+        return;
+    }
+
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+
+    if (match == 15) {
+        write_length(out, match_size - MIN_MATCH - 15);
+    }
+}
+
+// false past the end of the input
+bool read_length(const uint8_t *&in, const uint8_t *end, size_t &length) {
+    uint8_t b;
+
+    do {
+        if (in == end) {
+            return false;
+        }
+
+        b = *in++;
+        length += b;
+    } while (b == 255);
+
+    return true;
+}
+}  // namespace
+
+const PackEntry *PackView::find(std::string_view name) const {
+    const PackEntry *end = entry + header->entry_count;
+    const PackEntry *it = std::lower_bound(entry, end, name, [&](const PackEntry &e, std::string_view n) {
+        return this->name(e) < n;
+    });
+
+    if (it != end && this->name(*it) == name) {
+        return it;
+    }
+
+    return nullptr;
+}
+
+const char *view_asset_pack(const void *data, size_t size, PackView &view) {
+    static_assert(sizeof(PackHeader) % 8 == 0 && sizeof(PackEntry) % 8 == 0);
+
+    if (reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+        return "data not 8 byte aligned";
+    }
+
+    if (size < sizeof(PackHeader)) {
+        return "truncated header";
+    }
+
+    const PackHeader *h = static_cast<const PackHeader *>(data);
+
+    if (h->magic != PACK_MAGIC) {
+        return "bad magic";
+    }
+
+    if (h->version != PACK_VERSION) {
+        return "unsupported version";
+    }
+
+    if (h->entry_count > MAX_ENTRIES) {
+        return "bad entry count";
+    }
+
+    size_t index_end = sizeof(PackHeader) + h->entry_count * sizeof(PackEntry) + h->names_size;
+
+    if (index_end > size) {
+        return "truncated index";
+    }
+
+    view.data = static_cast<const uint8_t *>(data);
+    view.header = h;
+    view.entry = reinterpret_cast<const PackEntry *>(h + 1);
+    view.names = reinterpret_cast<const char *>(view.entry + h->entry_count);
+
+    for (uint32_t i = 0; i < h->entry_count; i++) {
+        const PackEntry &e = view.entry[i];
+
+        if (static_cast<uint64_t>(e.name_offset) + e.name_size > h->names_size) {
+            return "entry name out of range";
+        }
+
+        if (e.offset < index_end || e.offset % PACK_ALIGN != 0 || e.offset > size || e.size > size - e.offset) {
+            return "entry data out of range";
+        }
+
+        if (!(e.flags & PACK_COMPRESSED) && e.size != e.raw_size) {
+            return "stored entry size mismatch";
+        }
+
+        if (i > 0 && !(view.name(view.entry[i - 1]) < view.name(e))) {
+            return "names not strictly ascending";
+        }
+    }
+
+    return nullptr;
+}
+
+std::vector<uint8_t> lz_compress(const uint8_t *src, size_t size) {
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 16);
+
+    // position + 1 of the last 4 bytes with each hash, 0 for none
+    std::vector<uint32_t> table(size_t{1} << HASH_BITS, 0);
+
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while (i + MIN_MATCH <= size) {
+        uint32_t seq = read32(src + i);
+        uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+        size_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(i + 1);
+
+        if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != seq) {
+            i++;
+            continue;
+        }
+
+        size_t match = candidate - 1;
+        size_t length = MIN_MATCH;
+
+        while (i + length < size && src[match + length] == src[i + length]) {
+            length++;
+        }
+
+        write_sequence(out, src + anchor, i - anchor, i - match, length);
+
+        i += length;
+        anchor = i;
+    }
+
+    write_sequence(out, src + anchor, size - anchor, 0, 0);
+
+    return out;
+}
+
+bool lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size) {
+    const uint8_t *in = src;
+    const uint8_t *end = src + size;
+    size_t out = 0;
+
+    while (in < end) {
+        uint8_t token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(in, end, literals)) {
+            return false;
+        }
+
+        if (literals > static_cast<size_t>(end - in) || literals > dst_size - out) {
+            return false;
+        }
+
+        if (literals > 0) {
+            memcpy(dst + out, in, literals);
+        }
+
+        in += literals;
+        out += literals;
+
+        // the last sequence ends with its literals
+        if (in == end) {
+            break;
+        }
+
+        if (end - in < 2) {
+            return false;
+        }
+
+        size_t offset = static_cast<size_t>(in[0] | in[1] << 8);
+        in += 2;
+
+        size_t length = (token & 0xF);
+        if (length == 15 && !read_length(in, end, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+
+        if (offset == 0 || offset > out || length > dst_size - out) {
+            return false;
+        }
+
+        // may overlap the output it copies, byte by byte repeats the pattern
+        for (size_t k = 0; k < length; k++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+
+    return out == dst_size;
+}
+
+std::vector<uint8_t> write_asset_pack(std::vector<PackInput> inputs) {
+    std::sort(inputs.begin(), inputs.end(), [](const PackInput &a, const PackInput &b) { return a.name < b.name; });
+
+    // a repeated name keeps the last one
+    auto last = std::unique(inputs.rbegin(), inputs.rend(), [](const PackInput &a, const PackInput &b) {
+        return a.name == b.name;
+    });
+    inputs.erase(inputs.begin(), last.base());
+
+    PackHeader header;
+    header.entry_count = static_cast<uint32_t>(inputs.size());
+
+    std::string names;
+    for (const PackInput &in : inputs) {
+        names += in.name;
+    }
+    header.names_size = static_cast<uint32_t>(names.size());
+
+    auto align = [](size_t v) { return (v + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN; };
+
+    size_t offset = align(sizeof(PackHeader) + inputs.size() * sizeof(PackEntry) + names.size());
+
+    std::vector<PackEntry> entries;
+    std::vector<std::vector<uint8_t>> stored;
+    uint32_t name_offset = 0;
+
+    for (PackInput &in : inputs) {
+        PackEntry e;
+        e.raw_size = in.data.size();
+        e.name_offset = name_offset;
+        e.name_size = static_cast<uint32_t>(in.name.size());
+        name_offset += e.name_size;
+
+        std::vector<uint8_t> data = std::move(in.data);
+
+        if (in.compress) {
+            std::vector<uint8_t> packed = lz_compress(data.data(), data.size());
+
+            if (packed.size() < data.size() - data.size() / 8) {
+                data = std::move(packed);
+                e.flags |= PACK_COMPRESSED;
+            }
+        }
+
+        e.offset = offset;
+        e.size = data.size();
+        offset = align(offset + data.size());
+
+        entries.push_back(e);
+        stored.push_back(std::move(data));
+    }
+
+    std::vector<uint8_t> out(offset, 0);
+    memcpy(out.data(), &header, sizeof(header));
+    memcpy(out.data() + sizeof(header), entries.data(), entries.size() * sizeof(PackEntry));
+    memcpy(out.data() + sizeof(header) + entries.size() * sizeof(PackEntry), names.data(), names.size());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!stored[i].empty()) {
+            memcpy(out.data() + entries[i].offset, stored[i].data(), stored[i].size());
+        }
+    }
+
+    return out;
+}
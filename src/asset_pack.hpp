@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Packed asset archive, made by tools/asset_pack (cmake --build . --target assets_pak) and read through Vfs.
+// Little endian:
+//
+//   PackHeader
+//   PackEntry entry[entry_count]  sorted by name
+//   char names[names_size]        not null terminated
+//   entry data, each starting on a PACK_ALIGN boundary
+//
+// Stored entries are used in place. Compressed ones hold an LZ4 style block: sequences of a token
+// (literal length << 4 | match length - 4), literal length bytes past 15, the literals, a 16 bit
+// match offset and match length bytes past 15. The last sequence has literals only.
+constexpr uint32_t PACK_MAGIC = 0x4B504241;  // "ABPK"
+constexpr uint32_t PACK_VERSION = 1;
+constexpr size_t PACK_ALIGN = 16;
+
+constexpr uint32_t PACK_COMPRESSED = 1;
+
+struct PackHeader {
+    uint32_t magic = PACK_MAGIC;
+    uint32_t version = PACK_VERSION;
+    uint32_t entry_count = 0;
+    uint32_t names_size = 0;
+};
+
+struct PackEntry {
+    uint64_t offset = 0;  // from the start of the archive
+    uint64_t size = 0;    // bytes in the archive
+    uint64_t raw_size = 0;
+    uint32_t name_offset = 0;
+    uint32_t name_size = 0;
+    uint32_t flags = 0;
+    uint32_t reserved = 0;
+};
+
+// Index pointing into the archive data.
+struct PackView {
+    const uint8_t *data = nullptr;
+    const PackHeader *header = nullptr;
+    const PackEntry *entry = nullptr;
+    const char *names = nullptr;
+
+    std::string_view name(const PackEntry &e) const { return {names + e.name_offset, e.name_size}; }
+    // nullptr when there's no such entry
+    const PackEntry *find(std::string_view name) const;
+};
+
+// nullptr when data holds a valid archive, otherwise what's wrong with it. Checks the index only.
+// data must be 8 byte aligned (malloc and mmap are).
+const char *view_asset_pack(const void *data, size_t size, PackView &view);
+
+std::vector<uint8_t> lz_compress(const uint8_t *src, size_t size);
+// False unless src decodes to exactly dst_size bytes.
+bool lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size);
+
+struct PackInput {
+    std::string name;
+    std::vector<uint8_t> data;
+    bool compress = false;  // kept stored when compression saves less than an eighth
+};
+
+std::vector<uint8_t> write_asset_pack(std::vector<PackInput> inputs);
@@ -0,0 +1,225 @@
+#include "atlas_format.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+// enough for any real font, keeps a corrupt count from overflowing the size computation
+constexpr uint32_t MAX_GLYPHS = 1 << 20;
+}  // namespace
+
+Glyph AtlasView::glyph(size_t i) const {
+    return Glyph{advance[i],
+                 plane[0][i],
+                 plane[1][i],
+                 plane[2][i],
+                 plane[3][i],
+                 atlas[0][i],
+                 atlas[1][i],
+                 atlas[2][i],
+                 atlas[3][i]};
+}
+
+size_t atlas_bin_size(uint32_t glyph_count) {
+    // unicode + advance + 4 plane + 4 atlas
+    return sizeof(AtlasHeader) + static_cast<size_t>(glyph_count) * 10 * sizeof(float);
+}
+
+const char *view_atlas_bin(const void *data, size_t size, AtlasView &view) {
+    static_assert(sizeof(AtlasHeader) % 4 == 0 && sizeof(int32_t) == sizeof(float));
+
+    if (reinterpret_cast<uintptr_t>(data) % 4 != 0) {
+        return "data not 4 byte aligned";
+    }
+
+    if (size < sizeof(AtlasHeader)) {
+        return "truncated header";
+    }
+
+    const AtlasHeader *h = static_cast<const AtlasHeader *>(data);
+
+    if (h->magic != ATLAS_MAGIC) {
+        return "bad magic";
+    }
+
+    if (h->version != ATLAS_VERSION) {
+        return "unsupported version";
+    }
+
+    if (h->glyph_count == 0 || h->glyph_count > MAX_GLYPHS) {
+        return "bad glyph count";
+    }
+
+    if (size != atlas_bin_size(h->glyph_count)) {
+        return "size doesn't match the glyph count";
+    }
+
+    if (!(h->em_size > 0.f) || h->grid_width == 0 || h->grid_height == 0) {
+        return "bad metrics";
+    }
+
+    size_t n = h->glyph_count;
+    const float *f = reinterpret_cast<const float *>(h + 1);
+
+    view.header = h;
+    view.unicode = reinterpret_cast<const int32_t *>(f);
+    view.advance = f + n;
+
+    for (size_t i = 0; i < 4; i++) {
+        view.plane[i] = f + n * (2 + i);
+        view.atlas[i] = f + n * (6 + i);
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        if (view.unicode[i] <= view.unicode[i - 1]) {
+            return "code points not strictly ascending";
+        }
+    }
+
+    for (size_t i = n; i < n * 10; i++) {
+        if (!std::isfinite(f[i])) {
+            return "non finite metric";
+        }
+    }
+
+    return nullptr;
+}
+
+const char *parse_atlas_txt(const char *text, AtlasHeader &header, std::vector<std::pair<int, Glyph>> &glyphs) {
+    const char *p = text;
+
+    auto label = [&](const char *expected) {
+        while (isspace(static_cast<unsigned char>(*p))) {
+            p++;
+        }
+
+        size_t len = strlen(expected);
+        if (strncmp(p, expected, len) != 0 || !isspace(static_cast<unsigned char>(p[len]))) {
+            return false;
+        }
+
+        p += len;
+        return true;
+    };
+
+    auto number = [&](float &out) {
+        char *end = nullptr;
+        out = strtof(p, &end);
+
+        if (end == p) {
+            return false;
+        }
+
+        p = end;
+        return true;
+    };
+
+    auto metric = [&](const char *name, uint32_t &out) {
+        float v = 0.f;
+        if (!label(name) || !number(v) || !(v > 0.f)) {
+            return false;
+        }
+
+        out = static_cast<uint32_t>(v);
+        return true;
+    };
+
+    header = AtlasHeader{};
+
+    if (!metric("distance_range", header.distance_range) || !label("em_size") || !number(header.em_size) ||
+        !metric("grid_width", header.grid_width) || !metric("grid_height", header.grid_height) ||
+        !label("unicode")) {
+        return "bad header";
+    }
+
+    glyphs.clear();
+
+    while (true) {
+        char *end = nullptr;
+        long unicode = strtol(p, &end, 10);
+
+        if (end == p) {
+            break;
+        }
+
+        p = end;
+
+        Glyph g;
+        float *field[9] = {&g.advance,
+                           &g.plane_left,
+                           &g.plane_bottom,
+                           &g.plane_right,
+                           &g.plane_top,
+                           &g.atlas_left,
+                           &g.atlas_bottom,
+                           &g.atlas_right,
+                           &g.atlas_top};
+
+        for (float *f : field) {
+            if (!number(*f)) {
+                return "truncated glyph";
+            }
+        }
+
+        glyphs.emplace_back(static_cast<int>(unicode), g);
+    }
+
+    while (isspace(static_cast<unsigned char>(*p))) {
+        p++;
+    }
+
+    if (*p != '\0') {
+        return "unexpected text after the glyphs";
+    }
+
+    if (glyphs.empty()) {
+        return "no glyphs";
+    }
+
+    return nullptr;
+}
+
+std::vector<uint8_t> write_atlas_bin(AtlasHeader header, std::vector<std::pair<int, Glyph>> glyphs) {
+    // stable so the last of a repeated code point ends up last, then keep only that one
+    std::stable_sort(glyphs.begin(), glyphs.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    auto last = std::unique(glyphs.rbegin(), glyphs.rend(), [](const auto &a, const auto &b) {
+        return a.first == b.first;
+    });
+    glyphs.erase(glyphs.begin(), last.base());
+
+    size_t n = glyphs.size();
+
+    header.magic = ATLAS_MAGIC;
+    header.version = ATLAS_VERSION;
+    header.glyph_count = static_cast<uint32_t>(n);
+
+    std::vector<uint8_t> out(atlas_bin_size(header.glyph_count));
+    memcpy(out.data(), &header, sizeof(header));
+
+    int32_t *unicode = reinterpret_cast<int32_t *>(out.data() + sizeof(header));
+    float *f = reinterpret_cast<float *>(unicode);
+
+    for (size_t i = 0; i < n; i++) {
+        const Glyph &g = glyphs[i].second;
+        const float column[9] = {g.advance,
+                                 g.plane_left,
+                                 g.plane_bottom,
+                                 g.plane_right,
+                                 g.plane_top,
+                                 g.atlas_left,
+                                 g.atlas_bottom,
+                                 g.atlas_right,
+                                 g.atlas_top};
+
+        unicode[i] = glyphs[i].first;
+
+        for (size_t c = 0; c < 9; c++) {
+            f[n * (c + 1) + i] = column[c];
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "glyph_table.hpp"
+
+// Binary font atlas metrics, made from atlas.txt by tools/atlas_pack (cmake --build . --target atlas_bin).
+// Used in place after validation, nothing is parsed. Little endian, every section is 4 byte aligned:
+//
+//   AtlasHeader
+//   int32 unicode[glyph_count]  strictly ascending
+//   float advance[glyph_count]
+//   float plane[4][glyph_count]  left, bottom, right, top
+//   float atlas[4][glyph_count]  left, bottom, right, top
+//
+// Same units as the Glyph fields.
+constexpr uint32_t ATLAS_MAGIC = 0x4C544241;  // "ABTL"
+constexpr uint32_t ATLAS_VERSION = 1;
+
+struct AtlasHeader {
+    uint32_t magic = ATLAS_MAGIC;
+    uint32_t version = ATLAS_VERSION;
+    uint32_t glyph_count = 0;
+    uint32_t distance_range = 0;
+    float em_size = 0.f;
+    uint32_t grid_width = 0;
+    uint32_t grid_height = 0;
+    uint32_t reserved = 0;
+};
+
+// Arrays point into the file data.
+struct AtlasView {
+    const AtlasHeader *header = nullptr;
+    const int32_t *unicode = nullptr;
+    const float *advance = nullptr;
+    const float *plane[4]{};
+    const float *atlas[4]{};
+
+    Glyph glyph(size_t i) const;
+};
+
+size_t atlas_bin_size(uint32_t glyph_count);
+
+// nullptr when data holds a valid atlas, otherwise what's wrong with it.
+// data must be 4 byte aligned (malloc and mmap are).
+const char *view_atlas_bin(const void *data, size_t size, AtlasView &view);
+
+// msdf-atlas-gen text metrics: distance_range, em_size, grid_width and grid_height label/value pairs,
+// then "unicode" and one glyph per line (code point then the Glyph fields in order).
+// text must be null terminated. nullptr on success, otherwise what's wrong with it.
+const char *parse_atlas_txt(const char *text, AtlasHeader &header, std::vector<std::pair<int, Glyph>> &glyphs);
+
+// glyphs in any order, a repeated code point keeps the last one
+std::vector<uint8_t> write_atlas_bin(AtlasHeader header, std::vector<std::pair<int, Glyph>> glyphs);
@@ -7,6 +7,7 @@
 
 #include "log.hpp"
 #include "stb_vorbis.hpp"
+#include "trace.hpp"
 
 void Audio::play(bool clear_stream) {
     if (stream) {
@@ -59,17 +60,30 @@ std::optional<Audio> load_ogg(SDL_AudioDeviceID audio_device, const char *path,
         return {};
     }
 
+    std::optional<Audio> ret = load_ogg(audio_device, std::span<const uint8_t>(data, data_size), volume);
+    SDL_free(data);
+
+    return ret;
+}
+
+std::optional<Audio> load_ogg(SDL_AudioDeviceID audio_device, std::span<const uint8_t> ogg, float volume) {
+    TRACE_ZONE("ogg decode");
+
     Audio ret;
 
     short *output;
-    int samples =
-        stb_vorbis_decode_memory(data, static_cast<int>(data_size), &ret.spec.channels, &ret.spec.freq, &output);
+    int samples = stb_vorbis_decode_memory(
+        ogg.data(), static_cast<int>(ogg.size()), &ret.spec.channels, &ret.spec.freq, &output);
+
+    if (samples < 0) {
+        LOG("Failed to decode Ogg Vorbis data");
+        return {};
+    }
 
     ret.data.resize(static_cast<size_t>(samples * ret.spec.channels) * sizeof(short));
     memcpy(ret.data.data(), output, ret.data.size());
 
     free(output);
-    SDL_free(data);
 
     ret.spec.format = SDL_AUDIO_S16LE;
 
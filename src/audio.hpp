@@ -3,6 +3,7 @@
 #include <SDL3/SDL.h>
 
 #include <optional>
+#include <span>
 #include <vector>
 
 struct Audio {
@@ -14,4 +15,6 @@ struct Audio {
 };
 
 std::optional<Audio> load_ogg(SDL_AudioDeviceID audio_device, const char *path, float volume = 1.0f);
+// Ogg Vorbis file contents, e.g. from Vfs::read.
+std::optional<Audio> load_ogg(SDL_AudioDeviceID audio_device, std::span<const uint8_t> ogg, float volume = 1.0f);
 std::optional<Audio> load_wav(SDL_AudioDeviceID audio_device, const char *path, float volume = 1.0f);
@@ -0,0 +1,314 @@
+#include "bench_scene.hpp"
+
+#include <SDL3/SDL_timer.h>
+
+#include <array>
+#include <cstdio>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "color_palette.hpp"
+#include "log.hpp"
+
+namespace {
+constexpr int TILE_COLS = 24;
+constexpr int TILE_ROWS = 13;
+constexpr int OUTLINES = 6;
+
+constexpr int QUAD_COLS = 64;
+constexpr int QUAD_ROWS = 36;
+
+constexpr int TEXT_LINES = 40;
+constexpr int TEXT_COLUMNS = 84;
+
+// UTF-8, mostly characters the atlas doesn't have
+constexpr std::array<const char *, 3> GLYPH_SENTENCES{
+    "Zwölf Boxkämpfer jagen Viktor quer über den großen Sylter Deich",
+    "Γαζέες καὶ μυρτιὲς δὲν θὰ βρῶ πιὰ στὸ χρυσαφὶ ξέφωτο",
+    "Съешь же ещё этих мягких французских булок да выпей чаю",
+};
+
+constexpr float FILL_OUTLINE_FACTOR = 0.1f;
+
+std::string variant_name(int variant) {
+    std::string name = variant & FONT_VARIANT_OUTLINE ? "outline" : "plain";
+    name += variant & FONT_VARIANT_TRANSPARENT_BG ? ", transparent bg" : ", opaque bg";
+
+    if (variant & FONT_VARIANT_PREMULTIPLIED) {
+        name += ", premultiplied";
+    }
+
+    return name;
+}
+
+constexpr std::array<glm::vec4, 4> TILE_COLOR{Color::blue, Color::orange, Color::teal, Color::purple};
+
+// Tile i of set k has 3 + (i + k) % OUTLINES + k % 3 sides, consecutive sets share all but one outline.
+std::vector<Shape> make_tiles(int set, const glm::vec2 &area) {
+    std::vector<Shape> tiles;
+    glm::vec2 cell{area.x / TILE_COLS, area.y / TILE_ROWS};
+
+    for (int i = 0; i < TILE_COLS * TILE_ROWS; i++) {
+        int sides = 3 + (i + set) % OUTLINES + set % 3;
+
+        // even side counts make stars
+        std::vector<float> radius = sides % 2 ? std::vector<float>{1.f} : std::vector<float>{1.f, 0.6f};
+
+        Shape s = make_shape(make_polygon(sides, radius),
+                             0.15f,
+                             Color::darkgrey,
+                             TILE_COLOR[static_cast<size_t>(i) % TILE_COLOR.size()]);
+
+        glm::vec2 grid_pos{static_cast<float>(i % TILE_COLS), static_cast<float>(i / TILE_COLS)};
+        s.trans = cell * (grid_pos + glm::vec2{0.5f});
+        s.scale = cell.y * 0.4f;
+        s.theta = static_cast<float>(i);
+        tiles.push_back(std::move(s));
+    }
+
+    return tiles;
+}
+}  // namespace
+
+bool BenchScene::known(const std::string &name) {
+    return name == "shapes" || name == "shape_batch" || name == "draws" || name == "text" || name == "glyphs" ||
+           name == "fill" || name == "layer_cache";
+}
+
+void BenchScene::update_tiles(int frame, const glm::vec2 &area) {
+    int set = frame / SET_FRAMES;
+
+    if (set != tile_set) {
+        // the new set takes its references first, so outlines both sets use stay cached
+        std::vector<Shape> next = make_tiles(set, area);
+
+        for (Shape &s : tiles) {
+            s.release();
+        }
+
+        tiles = std::move(next);
+        tile_set = set;
+    }
+}
+
+void BenchScene::draw_shapes(const ShapeShader &shape_shader, int frame, const glm::vec2 &area) {
+    update_tiles(frame, area);
+
+    uint64_t start = SDL_GetTicksNS();
+
+    for (Shape &s : tiles) {
+        s.theta += 0.02f;
+        draw_shape(shape_shader, s, true, true, false);
+    }
+
+    items += tiles.size();
+    cpu_ns += SDL_GetTicksNS() - start;
+}
+
+void BenchScene::draw_shape_batch(const ShapeShader &shape_shader, int frame, const glm::vec2 &area) {
+    update_tiles(frame, area);
+
+    uint64_t start = SDL_GetTicksNS();
+
+    for (Shape &s : tiles) {
+        s.theta += 0.02f;
+        batch.add(s, true, true, false);
+    }
+
+    batch.flush(shape_shader);
+
+    items += tiles.size();
+    cpu_ns += SDL_GetTicksNS() - start;
+}
+
+void BenchScene::draw_calls(const ShapeShader &shape_shader, const glm::vec2 &area) {
+    if (quads.empty()) {
+        glm::vec2 cell{area.x / QUAD_COLS, area.y / QUAD_ROWS};
+
+        for (int i = 0; i < QUAD_COLS * QUAD_ROWS; i++) {
+            glm::vec2 p0 = cell * glm::vec2{static_cast<float>(i % QUAD_COLS), static_cast<float>(i / QUAD_COLS)};
+            glm::vec2 p1 = p0 + cell * 0.8f;
+
+            std::vector<glm::vec2> vertex{p0, {p1.x, p0.y}, p1, {p0.x, p1.y}};
+            quads.push_back(make_vertex_buffer(vertex, {0, 1, 2, 0, 2, 3}));
+        }
+    }
+
+    const ShaderPtr &s = shape_shader.shader;
+    s->use();
+
+    glUniform1f(s->get_loc("scale"), 1.f);
+    glUniform1f(s->get_loc("theta"), 0.f);
+    glUniform2fv(s->get_loc("trans"), 1, glm::value_ptr(glm::vec2{0.f}));
+    glUniform4fv(s->get_loc("color"), 1, glm::value_ptr(Color::teal));
+
+    uint64_t start = SDL_GetTicksNS();
+
+    for (const VertexBufferPtr &q : quads) {
+        draw_vertex_buffer(s, q);
+    }
+
+    items += quads.size();
+    cpu_ns += SDL_GetTicksNS() - start;
+}
+
+void BenchScene::draw_text(
+    FontShader &font_shader, FontAtlas &font, QuadIndex &quad_index, int frame, const glm::vec2 &area) {
+    float size = area.x / TEXT_COLUMNS;
+    float line_height = area.y / (TEXT_LINES + 1);
+    char line[160];
+
+    // every line changes every frame, like a transcript scrolling by
+    for (int i = 0; i < TEXT_LINES; i++) {
+        const char *sentence = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG";
+
+        if (name == "glyphs") {
+            sentence = GLYPH_SENTENCES[static_cast<size_t>(i) % GLYPH_SENTENCES.size()];
+        }
+
+        snprintf(line, sizeof(line), "%06d %02d %s %d", frame, i, sentence, (frame * 7919 + i * 104729) % 1000000);
+        text.add(font, line, glm::vec2{size, line_height * static_cast<float>(i + 1)}, size, 0);
+    }
+
+    font_shader.set_fg(Color::white);
+    text.flush(font_shader, font, quad_index);
+}
+
+void BenchScene::draw_fill(
+    FontShader &font_shader, const VertexBufferPtr &grid, const TexturePtr &tex, uint64_t fragments, int frame) {
+    int variant = frame % FONT_VARIANT_COUNT;
+
+    // pick the variant through the state it's chosen from, the rest of the frame gets the old state back
+    glm::vec4 bg = font_shader.uniform.bg;
+    glm::vec4 outline = font_shader.uniform.outline;
+    float outline_factor = font_shader.uniform.outline_factor;
+
+    bool with_outline = variant & FONT_VARIANT_OUTLINE;
+    font_shader.set_outline(glm::vec4{outline.r, outline.g, outline.b, 1.f});
+    font_shader.set_outline_factor(with_outline ? FILL_OUTLINE_FACTOR : 0.f);
+    font_shader.set_bg(variant & FONT_VARIANT_TRANSPARENT_BG ? glm::vec4{0.f} : Color::darkgrey);
+    font_shader.set_premultiplied(variant & FONT_VARIANT_PREMULTIPLIED);
+    font_shader.set_anim_pass(AnimPass::all);
+
+    const ShaderPtr &s = font_shader.shader();
+
+    if (variant & FONT_VARIANT_PREMULTIPLIED) {
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    glFinish();
+    uint64_t start = SDL_GetTicksNS();
+
+    for (int i = 0; i < FILL_LAYERS; i++) {
+        draw_vertex_buffer(s, grid, tex);
+    }
+
+    glFinish();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // the first round compiles the variants
+    if (frame >= FONT_VARIANT_COUNT) {
+        fill_ns[static_cast<size_t>(variant)] += SDL_GetTicksNS() - start;
+        fill_layers[static_cast<size_t>(variant)] += FILL_LAYERS;
+        fill_fragments = fragments;
+    }
+
+    font_shader.set_bg(bg);
+    font_shader.set_outline(outline);
+    font_shader.set_outline_factor(outline_factor);
+    font_shader.set_premultiplied(false);
+}
+
+void BenchScene::begin_layer(LayerCache &cache, int frame) {
+    if (frame % 2 == 1) {
+        cache.invalidate();
+    }
+
+    layer_w = cache.fb->width();
+    layer_h = cache.fb->height();
+
+    glFinish();
+    layer_start = SDL_GetTicksNS();
+}
+
+void BenchScene::end_layer(int frame) {
+    glFinish();
+
+    // the first two frames build the cache and compile the shaders
+    if (frame >= 2) {
+        layer_ns[static_cast<size_t>(frame % 2)] += SDL_GetTicksNS() - layer_start;
+        layer_frames[static_cast<size_t>(frame % 2)]++;
+    }
+}
+
+void BenchScene::finish() {
+    if (items > 0) {
+        LOG("bench %s: %d drawn, %.3f us CPU each",
+            name.c_str(),
+            static_cast<int>(items),
+            static_cast<double>(cpu_ns) * 1e-3 / static_cast<double>(items));
+    }
+
+    quads.clear();
+
+    for (int v = 0; v < FONT_VARIANT_COUNT; v++) {
+        uint64_t ns = fill_ns[static_cast<size_t>(v)];
+        uint64_t layers = fill_layers[static_cast<size_t>(v)];
+
+        if (ns > 0) {
+            double layer_ms = static_cast<double>(ns) * 1e-6 / static_cast<double>(layers);
+            LOG("bench %s: %-38s %.3f ms per layer, %.0f Mfragments/s",
+                name.c_str(),
+                variant_name(v).c_str(),
+                layer_ms,
+                static_cast<double>(fill_fragments) * 1e-3 / layer_ms);
+        }
+    }
+
+    if (layer_frames[0] > 0 && layer_frames[1] > 0) {
+        double served_ms = static_cast<double>(layer_ns[0]) * 1e-6 / static_cast<double>(layer_frames[0]);
+        double rebuilt_ms = static_cast<double>(layer_ns[1]) * 1e-6 / static_cast<double>(layer_frames[1]);
+        LOG("bench %s: %dx%d layer served in %.3f ms, rebuilt in %.3f ms, %.3f ms saved per cached frame",
+            name.c_str(),
+            layer_w,
+            layer_h,
+            served_ms,
+            rebuilt_ms,
+            rebuilt_ms - served_ms);
+    }
+
+    if (text.flushes > 0) {
+        LOG("bench %s: %d glyphs in %d flushes, %.0f glyphs/ms",
+            name.c_str(),
+            static_cast<int>(text.glyphs),
+            static_cast<int>(text.flushes),
+            static_cast<double>(text.glyphs_per_ms()));
+
+        text = TextBatch{};
+    }
+
+    if (batch.flushes > 0) {
+        LOG("bench %s: %.1f instanced draws per flush",
+            name.c_str(),
+            static_cast<double>(batch.draws) / static_cast<double>(batch.flushes));
+
+        // the groups hold on to their geometry until the next flush
+        batch = ShapeBatch{};
+    }
+
+    if (!tiles.empty()) {
+        const ShapeStats &ss = shape_stats();
+        LOG("bench %s: %d shape buffers, %d KiB, geometry cache hits: %d, misses: %d",
+            name.c_str(),
+            static_cast<int>(ss.buffers),
+            static_cast<int>(ss.bytes / 1024),
+            static_cast<int>(ss.cache_hits),
+            static_cast<int>(ss.cache_misses));
+
+        for (Shape &s : tiles) {
+            s.release();
+        }
+
+        tiles.clear();
+        LOG("bench %s: %d shape buffers left after release", name.c_str(), static_cast<int>(ss.buffers));
+    }
+}
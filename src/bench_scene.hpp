@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "geometry.hpp"
+#include "layer_cache.hpp"
+#include "shape_batch.hpp"
+#include "text_batch.hpp"
+
+// Benchmark scenes for --headless, drawn over the regular frame. Each one repeats a single kind of work
+// many times per frame and logs its own counters after the run, Headless::report has the frame times.
+//
+// shapes: a grid of triangulated shapes, one draw_shape each. The set is replaced every SET_FRAMES frames
+//         by one with a single new outline, so the geometry cache shares the rest and frees the dropped one.
+// shape_batch: the same grid through ShapeBatch, one instanced draw per outline and pass.
+// draws: a grid of small quads, each its own VertexBuffer and draw call, for the CPU cost of a draw.
+// text: lines of text that change every frame through a TextBatch, logs its glyphs per ms.
+// glyphs: the text scene in scripts the atlas lacks, drawn from the GlyphCache once it has generated them.
+// fill: the letter grid drawn FILL_LAYERS times per frame with each font shader variant in turn,
+//       timed with glFinish around the layers for the MSDF fill rate of each variant.
+// layer_cache: the regular frame with the layer cache served on even frames and rebuilt on odd ones, timed with
+//              glFinish from the rebuild to the blit for what the cache saves, run it with --size 3840x2160.
+struct BenchScene {
+    static constexpr int SET_FRAMES = 60;
+    static constexpr int FILL_LAYERS = 8;
+
+    std::string name;
+
+    std::vector<Shape> tiles;
+    int tile_set = -1;
+    ShapeBatch batch;
+    std::vector<VertexBufferPtr> quads;
+    TextBatch text;
+    std::array<uint64_t, FONT_VARIANT_COUNT> fill_ns{};
+    std::array<uint64_t, FONT_VARIANT_COUNT> fill_layers{};
+    uint64_t fill_fragments = 0;  // per layer
+    std::array<uint64_t, 2> layer_ns{};  // served, rebuilt
+    std::array<uint64_t, 2> layer_frames{};
+    uint64_t layer_start = 0;
+    int layer_w = 0;
+    int layer_h = 0;
+
+    uint64_t items = 0;   // what the scene draws: shapes, draw calls or glyphs
+    uint64_t cpu_ns = 0;  // spent issuing them
+
+    static bool known(const std::string &name);
+
+    // area is the drawing area in normalized units
+    void draw_shapes(const ShapeShader &shape_shader, int frame, const glm::vec2 &area);
+    void draw_shape_batch(const ShapeShader &shape_shader, int frame, const glm::vec2 &area);
+    void draw_calls(const ShapeShader &shape_shader, const glm::vec2 &area);
+    void draw_text(FontShader &font_shader, FontAtlas &font, QuadIndex &quad_index, int frame, const glm::vec2 &area);
+    // fragments is the area of the grid's quads in pixels
+    void draw_fill(
+        FontShader &font_shader, const VertexBufferPtr &grid, const TexturePtr &tex, uint64_t fragments, int frame);
+
+    // Around the layer cache's rebuild and draw in the regular frame, begin_layer invalidates it on odd frames.
+    void begin_layer(LayerCache &cache, int frame);
+    void end_layer(int frame);
+
+    // Logs the counters and frees what the scene holds, needs the GL context.
+    void finish();
+
+private:
+    void update_tiles(int frame, const glm::vec2 &area);
+};
@@ -1,289 +1,556 @@
 #include "font.hpp"
 
 #include <SDL3/SDL_surface.h>
+#include <SDL3/SDL_timer.h>
 
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
-#include <sstream>
 
+#include "atlas_format.hpp"
 #include "gl_helper.hpp"
 #include "log.hpp"
 
 namespace {
 const char *font_vertex_shader = R"(#version 300 es
-precision mediump float;    
+precision highp float;
 
 layout(location = 0) in vec2 pos;
 layout(location = 1) in vec2 atlas_tex_coord;
+layout(location = 2) in vec4 letter; // xy: pivot, z: animation slot, w: scale. (0, 0, 0, 1) when not supplied.
 
 uniform mat4 ortho_matrix;
 uniform vec2 trans;
 uniform float font_width;
+uniform vec4 fg_color;
+
+// constant for the whole draw, only needed to compute the screen pixel range
+uniform float distance_range;
+uniform float grid_width;
+uniform float display_width;
+uniform float outline_factor;
+
+// Slot 0 means no animation, use fg_color and font_width as is.
+// Must match FONT_ANIM_SLOTS.
+uniform float time; // seconds
+uniform vec4 anim_param[32]; // x: start time, y: frequency, z: scale, w: scale pulse
+uniform vec4 anim_color_lo[32];
+uniform vec4 anim_color_hi[32];
+uniform int anim_pass; // 0: all, 1: static letters only, 2: animated letters only
+
 out vec2 texCoord;
+out vec4 fg;
+out float screen_px_range; // signed distance field range in screen pixels
+out float outline_dist;
 
 void main() {
-    gl_Position = ortho_matrix * vec4(pos*font_width + trans, 0.0, 1.0);
+    int slot = int(letter.z);
+    float scale = letter.w;
+    fg = fg_color;
+
+    if (slot > 0) {
+        vec4 p = anim_param[slot];
+        float wave = sin(6.28318530718 * p.y * (time - p.x));
+
+        fg = mix(anim_color_lo[slot], anim_color_hi[slot], 0.5 + 0.5*wave);
+        scale *= p.z * (1.0 + p.w*wave);
+    }
+
+    float glyph_width = font_width * scale;
+    gl_Position = ortho_matrix * vec4(pos*glyph_width + letter.xy + trans, 0.0, 1.0);
     texCoord = atlas_tex_coord;
+
+    float norm_grid_width = grid_width / display_width;
+    screen_px_range = distance_range * glyph_width / norm_grid_width;
+    outline_dist = screen_px_range * outline_factor;
+
+    // move filtered out letters outside the clip volume
+    bool animated = slot > 0 && anim_param[slot].y > 0.0;
+    if ((anim_pass == 1 && animated) || (anim_pass == 2 && !animated)) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    }
 })";
 
+// Variants are selected with defines, see FontVariant.
+// OUTLINE: draw an outline of outline_factor
+// TRANSPARENT_BG: background is fully transparent, skip blending with it
+// PREMULTIPLIED: output premultiplied alpha, use with glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
 const char *font_fragment_shader = R"(#version 300 es
 precision mediump float;
 
 in vec2 texCoord;
+in vec4 fg;
+in float screen_px_range;
+in float outline_dist;
 out vec4 color;
 uniform sampler2D msdf;
 uniform vec4 bg_color;
-uniform vec4 fg_color;
 uniform vec4 outline_color;
-uniform float outline_factor;
-uniform float distance_range;
-uniform float grid_width;
-uniform float display_width;
-uniform float font_width;
 
 float median(float r, float g, float b) {
     return max(min(r, g), min(max(r, g), b));
 }
 
+vec4 over_bg(vec4 c, float opacity) {
+#ifdef TRANSPARENT_BG
+    return vec4(c.rgb, c.a * opacity);
+#else
+    return mix(bg_color, c, opacity);
+#endif
+}
+
 void main() {
     vec3 msd = texture(msdf, texCoord).rgb;
     float sd = median(msd.r, msd.g, msd.b);
+    float dist_px = screen_px_range*(sd - 0.5) + 0.5;
 
-    float norm_grid_width = grid_width / display_width;
-    float range_scale = font_width / norm_grid_width;
+#ifdef OUTLINE
+    // background -> outline over [-outline_dist, -outline_dist + 1], outline -> fg over [0, 1]
+    vec4 outer = over_bg(outline_color, clamp(dist_px + outline_dist, 0.0, 1.0));
+    color = mix(outer, fg, clamp(dist_px, 0.0, 1.0));
+#else
+    color = over_bg(fg, clamp(dist_px, 0.0, 1.0));
+#endif
+
+#ifdef PREMULTIPLIED
+    color.rgb *= color.a;
+#endif
+})";
+}  // namespace
 
-    float screen_px_range = distance_range * range_scale;
-    float dist_px = screen_px_range*(sd - 0.5) + 0.5;
-    float outline_dist = screen_px_range*outline_factor;
-
-    // There's probably some edge case I haven't tested.
-    if (outline_dist > 0.0) {
-        if (dist_px > 0.0 && dist_px < 1.0) { 
-            // inner and start of outline
-            color = mix(outline_color, fg_color, dist_px);
-        } else if (dist_px > -outline_dist && dist_px < -outline_dist + 1.0) {
-            // end of outline and background
-            float opacity = clamp(dist_px + outline_dist, 0.0, 1.0);
-            color = mix(bg_color, outline_color, opacity);
-        } else if (dist_px > -outline_dist && dist_px < 1.0) {
-            color = outline_color;
+bool FontAtlas::load(Vfs &vfs, const std::string &atlas_bmp, const std::string &atlas_txt) {
+    return prepare(vfs, atlas_bmp, atlas_txt) && upload();
+}
+
+bool FontAtlas::prepare(Vfs &vfs, const std::string &atlas_bmp, const std::string &atlas_txt) {
+    auto s = std::make_unique<Staged>();
+    s->vfs = &vfs;
+    s->bmp_name = atlas_bmp;
+
+    // prefer the ETC2 atlas from tools/atlas_compress next to the BMP
+    s->ktx_name = atlas_bmp.substr(0, atlas_bmp.rfind('.')) + ".ktx";
+    s->ktx = vfs.read(s->ktx_name);
+
+    if (!s->ktx) {
+        LOG("no compressed texture: %s", s->ktx_name.c_str());
+
+        AssetData bmp = vfs.read(atlas_bmp);
+
+        if (!bmp) {
+            LOG("Failed to open file '%s'.", atlas_bmp.c_str());
+            return false;
+        }
+
+        s->bmp = decode_bmp(bmp.bytes, atlas_bmp);
+
+        if (!s->bmp) {
+            return false;
+        }
+    }
+
+    uint64_t start = SDL_GetTicksNS();
+
+    // prefer the binary atlas from tools/atlas_pack next to the text metrics
+    std::string atlas_bin = atlas_txt.substr(0, atlas_txt.rfind('.')) + ".bin";
+    bool binary = true;
+
+    AssetData data = vfs.read(atlas_bin);
+
+    if (data) {
+        AtlasView view;
+
+        if (const char *err = view_atlas_bin(data.bytes.data(), data.bytes.size(), view)) {
+            LOG("%s: %s, falling back to %s", atlas_bin.c_str(), err, atlas_txt.c_str());
+            data = AssetData{};
         } else {
-            float opacity = clamp(dist_px, 0.0, 1.0);
-            color = mix(bg_color, fg_color, opacity);
+            s->header = *view.header;
+            s->parsed.reserve(s->header.glyph_count);
+
+            for (size_t i = 0; i < s->header.glyph_count; i++) {
+                s->parsed.emplace_back(view.unicode[i], view.glyph(i));
+            }
         }
-    } else {
-        float opacity = clamp(dist_px, 0.0, 1.0);
-        color = mix(bg_color, fg_color, opacity);
     }
-})";
-}  // namespace
 
-bool FontAtlas::load(const std::string &atlas_path, const std::string &atlas_txt) {
-    tex = make_texture(atlas_path);
+    if (!data) {
+        binary = false;
+        data = vfs.read(atlas_txt);
 
-    if (!tex) {
-        return false;
+        if (!data) {
+            LOG("Failed to open file '%s'.", atlas_txt.c_str());
+            return false;
+        }
+
+        // packed entries aren't null terminated
+        std::string text(reinterpret_cast<const char *>(data.bytes.data()), data.bytes.size());
+
+        if (const char *err = parse_atlas_txt(text.c_str(), s->header, s->parsed)) {
+            LOG("%s: %s", atlas_txt.c_str(), err);
+            return false;
+        }
     }
 
-    // quad for letter
-    std::vector<glm::vec4> empty_vert(4);
-    std::vector<uint32_t> index{0, 1, 2, 0, 2, 3};
+    LOG("font metrics: %d glyphs from %s in %.3f ms",
+        static_cast<int>(s->parsed.size()),
+        binary ? atlas_bin.c_str() : atlas_txt.c_str(),
+        static_cast<double>(SDL_GetTicksNS() - start) * 1e-6);
 
-    size_t data_size;
-    char *data = static_cast<char *>(SDL_LoadFile(atlas_txt.c_str(), &data_size));
+    staged = std::move(s);
+    return true;
+}
 
-    if (!data) {
-        LOG("Failed to open file '%s'.", atlas_txt.c_str());
-        return {};
+bool FontAtlas::upload() {
+    if (!staged) {
+        return false;
     }
 
-    std::string str(data);
-    std::stringstream ss(str);
-
-    std::string label;
-    ss >> label;
-    assert(label == "distance_range");
-    ss >> distance_range;
-    ss >> label;
-    assert(label == "em_size");
-    ss >> em_size;
-    ss >> label;
-    assert(label == "grid_width");
-    ss >> grid_width;
-    ss >> label;
-    assert(label == "grid_height");
-    ss >> grid_height;
-    ss >> label;
-    assert(label == "unicode");
-
-    while (true) {
-        int unicode;
-        ss >> unicode;
-
-        if (ss.eof()) {
-            break;
+    std::unique_ptr<Staged> s = std::move(staged);
+
+    if (s->ktx) {
+        tex = make_compressed_texture(s->ktx.bytes, s->ktx_name);
+
+        // not supported here, decode the BMP after all
+        if (!tex) {
+            AssetData bmp = s->vfs->read(s->bmp_name);
+
+            if (!bmp) {
+                LOG("Failed to open file '%s'.", s->bmp_name.c_str());
+                return false;
+            }
+
+            s->bmp = decode_bmp(bmp.bytes, s->bmp_name);
         }
+    }
 
-        Glyph g;
-        ss >> g.advance;
-        ss >> g.plane_left;
-        ss >> g.plane_bottom;
-        ss >> g.plane_right;
-        ss >> g.plane_top;
-        ss >> g.atlas_left;
-        ss >> g.atlas_bottom;
-        ss >> g.atlas_right;
-        ss >> g.atlas_top;
-
-        glyph[unicode] = g;
+    if (s->bmp) {
+        tex = make_texture(*s->bmp, s->bmp_name);
+    }
+
+    if (!tex) {
+        return false;
+    }
+
+    distance_range = static_cast<int>(s->header.distance_range);
+    em_size = s->header.em_size;
+    grid_width = static_cast<int>(s->header.grid_width);
+    grid_height = static_cast<int>(s->header.grid_height);
+
+    glyphs.build(s->parsed, em_size, tex->width, tex->height);
+    layout_cache.clear();
+
+    if (!glyphs.contains('?')) {
+        LOG("font atlas has no '?', missing characters will be blank");
     }
 
     return true;
 }
 
-std::pair<glm::vec2, glm::vec2> FontAtlas::get_char_uv(char ch) {
-    const Glyph &g = glyph[static_cast<int>(ch)];
+std::pair<glm::vec2, glm::vec2> FontAtlas::get_char_uv(char ch) const {
+    const GlyphQuad &q = glyphs.get(static_cast<unsigned char>(ch));
+    return {glm::vec2{q.uv.x, q.uv.y}, glm::vec2{q.uv.z, q.uv.w}};
+}
 
-    float w = static_cast<float>(tex->width);
-    float h = static_cast<float>(tex->height);
-    glm::vec2 start{g.atlas_left / w, 1 - g.atlas_bottom / h};
-    glm::vec2 end{g.atlas_right / w, 1 - g.atlas_top / h};
+std::vector<glm::vec4> FontAtlas::make_letter(float x, float y, char ch) {
+    // pos + uv
+    std::vector<glm::vec4> vertex_uv;
+    layout_text(std::string(1, ch), false, vertex_uv);
 
-    return {start, end};
+    for (auto &v : vertex_uv) {
+        v.x += x;
+        v.y += y;
+    }
+
+    return vertex_uv;
 }
 
-std::vector<glm::vec4> FontAtlas::make_letter(float x, float y, char ch) {
-    auto [start, end] = get_char_uv(ch);
+TextLayoutPtr FontAtlas::layout(const std::string &str, bool normalize) {
+    if (TextLayoutPtr l = layout_cache.find(str, normalize)) {
+        return l;
+    }
 
-    const Glyph &g = glyph[static_cast<int>(ch)];
+    auto l = std::make_shared<TextLayout>();
+    l->vertex_uv.reserve(str.size() * 4);
+    l->bbox = layout_text(str, normalize, l->vertex_uv);
 
-    float w = (g.atlas_right - g.atlas_left);
-    float h = (g.atlas_top - g.atlas_bottom);
-    float xoff = g.plane_left * em_size;
-    float yoff = std::abs(g.plane_bottom) * em_size;
+    layout_cache.insert(str, normalize, l);
 
-    x += xoff;
-    y += yoff;
+    return l;
+}
 
-    // pos + uv
-    return std::vector<glm::vec4>{
-        {x, y, start.x, start.y},
-        {x + w, y, end.x, start.y},
-        {x + w, y - h, end.x, end.y},
-        {x, y - h, start.x, end.y},
-    };
+BBox FontAtlas::layout_text(const std::string &str, bool normalize, std::vector<glm::vec4> &vertex_uv) const {
+    GlyphBounds b = layout_glyphs(glyphs, str, normalize ? 1.f / static_cast<float>(grid_width) : 1.f, vertex_uv);
+    return {b.start, b.end};
 }
 
 std::pair<std::vector<glm::vec4>, std::vector<uint32_t>> FontAtlas::make_text_vertex(const std::string &str,
                                                                                      bool normalize) {
-    float xpos = 0;
-
-    std::vector<glm::vec4> vertex_uv;
+    std::vector<glm::vec4> vertex_uv = layout(str, normalize)->vertex_uv;
     std::vector<uint32_t> index;
 
-    uint32_t vertex_count = 0;
+    // quad
+    for (uint32_t i = 0; i < static_cast<uint32_t>(str.size()); i++) {
+        for (uint32_t idx : {0, 1, 2, 0, 2, 3}) {
+            index.push_back(i * 4 + idx);
+        }
+    }
+
+    return {vertex_uv, index};
+}
 
-    for (char ch : str) {
-        auto v = make_letter(xpos, 0, ch);
+std::pair<VertexBufferPtr, BBox> FontAtlas::make_text(QuadIndex &quad_index, const std::string &str, bool normalize) {
+    TextLayoutPtr l = layout(str, normalize);
+    const std::vector<glm::vec4> &vertex_uv = l->vertex_uv;
 
-        if (normalize) {
-            for (auto &v_ : v) {
-                v_.x /= static_cast<float>(grid_width);
-                v_.y /= static_cast<float>(grid_width);
-            }
-        }
+    auto v = make_quad_vertex_buffer(
+        quad_index, vertex_uv.data(), sizeof(glm::vec4) * vertex_uv.size(), str.size(), LAYOUT_POS_UV);
+    return {std::move(v), l->bbox};
+}
 
-        vertex_uv.insert(vertex_uv.end(), v.begin(), v.end());
+TextLayoutPtr LayoutCache::find(const std::string &str, bool normalize) {
+    auto &map = index[normalize];
+    auto it = map.find(str);
 
-        const Glyph &g = glyph[static_cast<int>(ch)];
-        xpos += g.advance * em_size;
+    if (it == map.end()) {
+        misses++;
+        return nullptr;
+    }
 
-        // quad
-        std::vector<uint32_t> idx{0, 1, 2, 0, 2, 3};
-        for (auto &i : idx) {
-            i += vertex_count;
-        }
-        index.insert(index.end(), idx.begin(), idx.end());
+    hits++;
+    lru.splice(lru.begin(), lru, it->second);
 
-        vertex_count += 4;
+    return it->second->layout;
+}
+
+void LayoutCache::insert(const std::string &str, bool normalize, TextLayoutPtr layout) {
+    auto entry_bytes = [](const Entry &e) {
+        return e.str.capacity() + e.layout->vertex_uv.capacity() * sizeof(glm::vec4) + sizeof(TextLayout);
+    };
+
+    auto &map = index[normalize];
+    auto it = map.find(str);
+
+    if (it != map.end()) {
+        bytes -= entry_bytes(*it->second);
+        lru.erase(it->second);
+        map.erase(it);
     }
 
-    return {vertex_uv, index};
+    while (!lru.empty() && lru.size() >= capacity) {
+        const Entry &old = lru.back();
+        bytes -= entry_bytes(old);
+        index[old.normalize].erase(old.str);
+        lru.pop_back();
+        evictions++;
+    }
+
+    lru.push_front(Entry{str, normalize, std::move(layout)});
+    map.emplace(str, lru.begin());
+    bytes += entry_bytes(lru.front());
 }
 
-std::pair<VertexBufferPtr, BBox> FontAtlas::make_text(const std::string &str, bool normalize) {
-    auto [vertex_uv, index] = make_text_vertex(str, normalize);
-    return {make_vertex_buffer(vertex_uv, index), bbox(vertex_uv)};
+void LayoutCache::clear() {
+    lru.clear();
+    index[0].clear();
+    index[1].clear();
+    bytes = 0;
+}
+
+float LayoutCache::hit_rate() const {
+    uint64_t total = hits + misses;
+    return total == 0 ? 0.f : static_cast<float>(static_cast<double>(hits) / static_cast<double>(total));
+}
+
+LetterVertex make_letter_vertex(const glm::vec4 &pos_uv, const glm::vec2 &pivot, int slot, float scale) {
+    return LetterVertex{{pos_uv.x, pos_uv.y},
+                        {pack_unorm16(pos_uv.z), pack_unorm16(pos_uv.w)},
+                        pivot,
+                        static_cast<float>(slot),
+                        scale};
 }
 
 bool FontShader::init(const FontAtlas &font_atlas) {
-    shader = make_shader(font_vertex_shader, font_fragment_shader);
+    uniform.distance_range = static_cast<float>(font_atlas.distance_range);
+    uniform.grid_width = static_cast<float>(font_atlas.grid_width);
 
-    if (shader) {
-        shader->use();
-        glUniform1i(shader->get_loc("msdf"), 0);
-        set_font_distance_range(static_cast<float>(font_atlas.distance_range));
-        set_font_grid_width(static_cast<float>(font_atlas.grid_width));
+    // variants are compiled on first use or by prepare(), call shader() after setting the style to catch errors early
+    return true;
+}
 
-        return true;
+int FontShader::current_variant() const {
+    int v = 0;
+
+    if (uniform.outline_factor > 0.f && uniform.outline.a > 0.f) {
+        v |= FONT_VARIANT_OUTLINE;
     }
 
-    return false;
+    if (uniform.bg.a == 0.f) {
+        v |= FONT_VARIANT_TRANSPARENT_BG;
+    }
+
+    if (uniform.premultiplied) {
+        v |= FONT_VARIANT_PREMULTIPLIED;
+    }
+
+    return v;
 }
 
-void FontShader::set_trans(const glm::vec2 &trans) const {
-    assert(shader);
-    shader->use();
-    glUniform2fv(shader->get_loc("trans"), 1, glm::value_ptr(trans));
+void FontShader::prepare() {
+    int v = current_variant();
+    ShaderPtr &s = variant[static_cast<size_t>(v)];
+
+    if (s) {
+        return;
+    }
+
+    std::vector<std::string> defines;
+
+    if (v & FONT_VARIANT_OUTLINE) {
+        defines.push_back("OUTLINE");
+    }
+
+    if (v & FONT_VARIANT_TRANSPARENT_BG) {
+        defines.push_back("TRANSPARENT_BG");
+    }
+
+    if (v & FONT_VARIANT_PREMULTIPLIED) {
+        defines.push_back("PREMULTIPLIED");
+    }
+
+    LOG("compiling font shader variant %d", v);
+    s = make_shader(font_vertex_shader, font_fragment_shader, defines);
+    applied[static_cast<size_t>(v)] = false;
+}
+
+const ShaderPtr &FontShader::shader() {
+    prepare();
+
+    size_t v = static_cast<size_t>(current_variant());
+    ShaderPtr &s = variant[v];
+
+    if (s && !applied[v]) {
+        if (!s->wait()) {
+            s.reset();
+            return s;
+        }
+
+        apply_all(s);
+        applied[v] = true;
+    }
+
+    return s;
+}
+
+void FontShader::apply_all(const ShaderPtr &s) const {
+    const FontUniforms &u = uniform;
+
+    s->use();
+    glUniform1i(s->get_loc("msdf"), 0);
+    glUniformMatrix4fv(s->get_loc("ortho_matrix"), 1, GL_FALSE, glm::value_ptr(u.ortho));
+    glUniform1f(s->get_loc("display_width"), u.display_width);
+    glUniform1f(s->get_loc("distance_range"), u.distance_range);
+    glUniform1f(s->get_loc("grid_width"), u.grid_width);
+    glUniform1f(s->get_loc("font_width"), u.font_width);
+    glUniform2fv(s->get_loc("trans"), 1, glm::value_ptr(u.trans));
+    glUniform4fv(s->get_loc("fg_color"), 1, glm::value_ptr(u.fg));
+    glUniform4fv(s->get_loc("bg_color"), 1, glm::value_ptr(u.bg));
+    glUniform4fv(s->get_loc("outline_color"), 1, glm::value_ptr(u.outline));
+    glUniform1f(s->get_loc("outline_factor"), u.outline_factor);
+    glUniform1f(s->get_loc("time"), u.time);
+    glUniform1i(s->get_loc("anim_pass"), static_cast<GLint>(u.anim_pass));
+
+    for (int slot = 1; slot < FONT_ANIM_SLOTS; slot++) {
+        apply_anim(s, slot);
+    }
+}
+
+void FontShader::apply_anim(const ShaderPtr &s, int slot) const {
+    const LetterAnim &anim = uniform.anim[static_cast<size_t>(slot)];
+
+    auto loc = [&](const char *name) { return s->get_loc((name + ("[" + std::to_string(slot) + "]")).c_str()); };
+
+    glUniform4f(loc("anim_param"), anim.start_time, anim.frequency, anim.scale, anim.scale_pulse);
+    glUniform4fv(loc("anim_color_lo"), 1, glm::value_ptr(anim.color_lo));
+    glUniform4fv(loc("anim_color_hi"), 1, glm::value_ptr(anim.color_hi));
 }
 
-void FontShader::set_font_grid_width(float grid_width) const {
-    assert(shader);
-    glUniform1f(shader->get_loc("grid_width"), grid_width);
+template <typename F>
+void FontShader::for_each_variant(F f) const {
+    // variants still compiling get every uniform from apply_all on first use
+    for (size_t v = 0; v < variant.size(); v++) {
+        if (variant[v] && applied[v]) {
+            variant[v]->use();
+            f(variant[v]);
+        }
+    }
 }
 
-void FontShader::set_font_width(float font_width) const {
-    assert(shader);
-    glUniform1f(shader->get_loc("font_width"), font_width);
+void FontShader::set_trans(const glm::vec2 &trans) {
+    uniform.trans = trans;
+    for_each_variant([&](const ShaderPtr &s) { glUniform2fv(s->get_loc("trans"), 1, glm::value_ptr(trans)); });
 }
 
-void FontShader::set_font_distance_range(float range) const {
-    assert(shader);
-    glUniform1f(shader->get_loc("distance_range"), range);
+void FontShader::set_font_grid_width(float grid_width) {
+    uniform.grid_width = grid_width;
+    for_each_variant([&](const ShaderPtr &s) { glUniform1f(s->get_loc("grid_width"), grid_width); });
 }
 
-void FontShader::set_fg(const glm::vec4 &color) const {
-    assert(shader);
-    shader->use();
-    glUniform4fv(shader->get_loc("fg_color"), 1, glm::value_ptr(color));
+void FontShader::set_font_width(float font_width) {
+    uniform.font_width = font_width;
+    for_each_variant([&](const ShaderPtr &s) { glUniform1f(s->get_loc("font_width"), font_width); });
 }
 
-void FontShader::set_bg(const glm::vec4 &color) const {
-    assert(shader);
-    shader->use();
-    glUniform4fv(shader->get_loc("bg_color"), 1, glm::value_ptr(color));
+void FontShader::set_font_distance_range(float range) {
+    uniform.distance_range = range;
+    for_each_variant([&](const ShaderPtr &s) { glUniform1f(s->get_loc("distance_range"), range); });
 }
 
-void FontShader::set_outline(const glm::vec4 &color) const {
-    assert(shader);
-    shader->use();
-    glUniform4fv(shader->get_loc("outline_color"), 1, glm::value_ptr(color));
+void FontShader::set_fg(const glm::vec4 &color) {
+    uniform.fg = color;
+    for_each_variant([&](const ShaderPtr &s) { glUniform4fv(s->get_loc("fg_color"), 1, glm::value_ptr(color)); });
 }
 
-void FontShader::set_outline_factor(float factor) const {
-    assert(shader);
-    shader->use();
-    glUniform1f(shader->get_loc("outline_factor"), factor);
+void FontShader::set_bg(const glm::vec4 &color) {
+    uniform.bg = color;
+    for_each_variant([&](const ShaderPtr &s) { glUniform4fv(s->get_loc("bg_color"), 1, glm::value_ptr(color)); });
 }
 
-void FontShader::set_ortho(const glm::mat4 &ortho) const {
-    assert(shader);
-    shader->use();
-    glUniformMatrix4fv(shader->get_loc("ortho_matrix"), 1, GL_FALSE, glm::value_ptr(ortho));
+void FontShader::set_time(float secs) {
+    uniform.time = secs;
+    for_each_variant([&](const ShaderPtr &s) { glUniform1f(s->get_loc("time"), secs); });
+}
+
+void FontShader::set_anim(int slot, const LetterAnim &anim) {
+    assert(slot > 0 && slot < FONT_ANIM_SLOTS);
+
+    uniform.anim[static_cast<size_t>(slot)] = anim;
+    for_each_variant([&](const ShaderPtr &s) { apply_anim(s, slot); });
+}
+
+void FontShader::set_anim_pass(AnimPass pass) {
+    uniform.anim_pass = pass;
+    for_each_variant([&](const ShaderPtr &s) { glUniform1i(s->get_loc("anim_pass"), static_cast<GLint>(pass)); });
+}
+
+void FontShader::set_outline(const glm::vec4 &color) {
+    uniform.outline = color;
+    for_each_variant(
+        [&](const ShaderPtr &s) { glUniform4fv(s->get_loc("outline_color"), 1, glm::value_ptr(color)); });
+}
+
+void FontShader::set_outline_factor(float factor) {
+    uniform.outline_factor = factor;
+    for_each_variant([&](const ShaderPtr &s) { glUniform1f(s->get_loc("outline_factor"), factor); });
+}
+
+void FontShader::set_premultiplied(bool premultiplied) { uniform.premultiplied = premultiplied; }
+
+void FontShader::set_ortho(const glm::mat4 &ortho) {
+    uniform.ortho = ortho;
+    for_each_variant([&](const ShaderPtr &s) {
+        glUniformMatrix4fv(s->get_loc("ortho_matrix"), 1, GL_FALSE, glm::value_ptr(ortho));
+    });
 }
 
-void FontShader::set_display_width(float display_width) const {
-    assert(shader);
-    shader->use();
-    glUniform1f(shader->get_loc("display_width"), display_width);
+void FontShader::set_display_width(float display_width) {
+    uniform.display_width = display_width;
+    for_each_variant([&](const ShaderPtr &s) { glUniform1f(s->get_loc("display_width"), display_width); });
 }
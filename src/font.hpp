@@ -2,25 +2,54 @@
 
 #include <SDL3/SDL_opengles2.h>
 
+#include <array>
 #include <glm/glm.hpp>
-#include <map>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "atlas_format.hpp"
 #include "gl_helper.hpp"
+#include "glyph_table.hpp"
+#include "vfs.hpp"
 
-// How to render the Glyph
-// Plane is offset relative to cursor pos
-// Atlas is bounding box in the texture atlas
-struct Glyph {
-    float advance;     // em, x increment
-    float plane_left;  // em
-    float plane_bottom;
-    float plane_right;
-    float plane_top;
-    float atlas_left;  // pixel
-    float atlas_bottom;
-    float atlas_right;
-    float atlas_top;
+// Laid out text, shared and never modified once built.
+struct TextLayout {
+    std::vector<glm::vec4> vertex_uv;  // 4 pos + uv vertices per character
+    BBox bbox;
+};
+
+using TextLayoutPtr = std::shared_ptr<const TextLayout>;
+
+// Least recently used cache of text layouts, one map per normalize flag so a lookup takes the string
+// as is. Entries are only valid for the atlas they were made with, FontAtlas::load clears it.
+// Not thread safe, use it from the thread that lays out text.
+struct LayoutCache {
+    struct Entry {
+        std::string str;
+        bool normalize;
+        TextLayoutPtr layout;
+    };
+
+    size_t capacity = 256;  // entries
+
+    std::list<Entry> lru;  // most recent first
+    std::array<std::unordered_map<std::string, std::list<Entry>::iterator>, 2> index;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t bytes = 0;  // strings and vertex data held by the entries
+
+    // nullptr on a miss, a hit allocates nothing
+    TextLayoutPtr find(const std::string &str, bool normalize);
+    void insert(const std::string &str, bool normalize, TextLayoutPtr layout);
+    void clear();
+
+    float hit_rate() const;
 };
 
 struct FontAtlas {
@@ -30,32 +59,149 @@ struct FontAtlas {
     float em_size;       // pixels per em unit
     int grid_width;
     int grid_height;
-    std::map<int, Glyph> glyph;
+    GlyphTable glyphs;
+    LayoutCache layout_cache;
 
-    bool load(const std::string &atlas_path, const std::string &atlas_txt);
-    std::pair<VertexBufferPtr, BBox> make_text(const std::string &str, bool normalize);
+    // read and decoded by prepare, consumed by upload
+    struct Staged {
+        Vfs *vfs = nullptr;
+        std::string bmp_name;
+        std::string ktx_name;
+        AssetData ktx;
+        SurfacePtr bmp{nullptr, SDL_DestroySurface};  // only without a KTX
+        AtlasHeader header;
+        std::vector<std::pair<int, Glyph>> parsed;
+    };
+    std::unique_ptr<Staged> staged;
+
+    // names are looked up in vfs, prepare then upload
+    bool load(Vfs &vfs, const std::string &atlas_bmp, const std::string &atlas_txt);
+    // Reads the files, decodes the texture and parses the metrics. No GL calls, safe on a worker
+    // thread as long as the atlas isn't used meanwhile. vfs must outlive upload.
+    bool prepare(Vfs &vfs, const std::string &atlas_bmp, const std::string &atlas_txt);
+    // Creates the texture and glyph table from what prepare staged, on the GL thread.
+    bool upload();
+    std::pair<VertexBufferPtr, BBox> make_text(QuadIndex &quad_index, const std::string &str, bool normalize);
     std::pair<std::vector<glm::vec4>, std::vector<uint32_t>> make_text_vertex(const std::string &str, bool normalize);
 
-    std::pair<glm::vec2, glm::vec2> get_char_uv(char ch);
+    // Cached layout of str, built on a miss. Keep the pointer rather than copying the vertices.
+    TextLayoutPtr layout(const std::string &str, bool normalize);
+
+    // Appends 4 pos + uv vertices per character to vertex_uv, no allocation if there's capacity.
+    // Returns the bounding box of the appended positions.
+    BBox layout_text(const std::string &str, bool normalize, std::vector<glm::vec4> &vertex_uv) const;
+
+    std::pair<glm::vec2, glm::vec2> get_char_uv(char ch) const;
     std::vector<glm::vec4> make_letter(float x, float y, char ch);
 };
 
+// Number of animation slots in the font shader, slot 0 is reserved for no animation.
+constexpr int FONT_ANIM_SLOTS = 32;
+
+// Evaluated entirely in the vertex shader from the time uniform.
+// color = mix(color_lo, color_hi, 0.5 + 0.5*wave)
+// scale = scale * (1 + scale_pulse*wave)
+// where wave = sin(2*pi*frequency*(time - start_time))
+struct LetterAnim {
+    float start_time = 0.f;  // seconds
+    float frequency = 0.f;   // Hz, 0 means the letter is static
+    float scale = 1.f;
+    float scale_pulse = 0.f;
+    glm::vec4 color_lo{};
+    glm::vec4 color_hi{};
+};
+
+// Which letters to draw, used to split static and animated letters into separate passes.
+enum class AnimPass { all = 0, static_only = 1, animated_only = 2 };
+
+// Vertex for text that carries its own position, animation slot and scale (LAYOUT_POS_UV_LETTER).
+// 28 bytes instead of 32 with uv as floats. pos stays float, text batches lay out whole strings around one pivot.
+struct LetterVertex {
+    glm::vec2 pos;   // relative to pivot
+    uint16_t uv[2];  // normalized
+    glm::vec2 pivot;
+    float slot;
+    float scale;
+};
+
+LetterVertex make_letter_vertex(const glm::vec4 &pos_uv, const glm::vec2 &pivot, int slot, float scale);
+
+// Shader variants, compiled on first use.
+enum FontVariant {
+    FONT_VARIANT_OUTLINE = 1,
+    FONT_VARIANT_TRANSPARENT_BG = 2,
+    FONT_VARIANT_PREMULTIPLIED = 4,
+    FONT_VARIANT_COUNT = 8,
+};
+
+// CPU copy of the uniforms so a variant compiled later starts with the same state.
+struct FontUniforms {
+    glm::mat4 ortho{1.f};
+    float display_width = 1.f;
+    float distance_range = 0.f;
+    float grid_width = 1.f;
+    float font_width = 1.f;
+    glm::vec2 trans{};
+    glm::vec4 fg{};
+    glm::vec4 bg{};
+    glm::vec4 outline{};
+    float outline_factor = 0.f;
+    float time = 0.f;
+    std::array<LetterAnim, FONT_ANIM_SLOTS> anim{};
+    AnimPass anim_pass = AnimPass::all;
+    bool premultiplied = false;
+};
+
+// The variant is picked from the current state: outline if outline_factor > 0,
+// transparent background if bg alpha is 0 and premultiplied alpha if requested.
+// Setters update every compiled variant.
 struct FontShader {
-    ShaderPtr shader{{}, {}};
+    std::array<ShaderPtr, FONT_VARIANT_COUNT> variant{
+        ShaderPtr{{}, {}},
+        ShaderPtr{{}, {}},
+        ShaderPtr{{}, {}},
+        ShaderPtr{{}, {}},
+        ShaderPtr{{}, {}},
+        ShaderPtr{{}, {}},
+        ShaderPtr{{}, {}},
+        ShaderPtr{{}, {}},
+    };
+    std::array<bool, FONT_VARIANT_COUNT> applied{};  // uniforms uploaded after linking
+    FontUniforms uniform;
 
     bool init(const FontAtlas &font_atlas);
 
+    // starts compiling the variant for the current state without waiting for it
+    void prepare();
+    // shader variant for the current state, compiles it if needed and waits for the link
+    const ShaderPtr &shader();
+    int current_variant() const;
+
     // call when window resizes
-    void set_ortho(const glm::mat4 &ortho) const;
-    void set_display_width(float display_width) const;
-
-    void set_font_distance_range(float range) const;
-    void set_font_grid_width(float range) const;
-    void set_font_width(float font_width) const;
-
-    void set_trans(const glm::vec2 &trans) const;
-    void set_fg(const glm::vec4 &color) const;
-    void set_bg(const glm::vec4 &color) const;
-    void set_outline(const glm::vec4 &color) const;
-    void set_outline_factor(float factor) const;
+    void set_ortho(const glm::mat4 &ortho);
+    void set_display_width(float display_width);
+
+    void set_font_distance_range(float range);
+    void set_font_grid_width(float range);
+    void set_font_width(float font_width);
+
+    void set_trans(const glm::vec2 &trans);
+    void set_fg(const glm::vec4 &color);
+    void set_bg(const glm::vec4 &color);
+    void set_outline(const glm::vec4 &color);
+    void set_outline_factor(float factor);
+
+    // caller must set glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA) to match
+    void set_premultiplied(bool premultiplied);
+
+    // per frame time in seconds used by the animations
+    void set_time(float secs);
+    void set_anim(int slot, const LetterAnim &anim);
+    void set_anim_pass(AnimPass pass);
+
+    void apply_all(const ShaderPtr &s) const;
+    void apply_anim(const ShaderPtr &s, int slot) const;
+
+    template <typename F>
+    void for_each_variant(F f) const;
 };
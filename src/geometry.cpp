@@ -2,10 +2,14 @@
 
 #include <SDL3/SDL_opengles2.h>
 
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <unordered_map>
 
 #include "gl_helper.hpp"
+#include "log.hpp"
+#include "tessellate.hpp"
 
 namespace {
 const char *vertex_shader = R"(#version 300 es
@@ -37,144 +41,258 @@ void main() {
     frag_color = color;
 })";
 
-}  // namespace
-   // :
-std::vector<glm::vec2> make_polygon(int sides, const std::vector<float> &radius) {
-    std::vector<glm::vec2> vert;
+// Same transform as vertex_shader, taken from per instance attributes.
+const char *instanced_vertex_shader = R"(#version 300 es
+precision mediump float;
 
-    for (int i = 0; i < sides; i++) {
-        float theta = static_cast<float>(i * 2 * M_PI / sides);
-        float r = radius[static_cast<size_t>(i) % radius.size()];
-        float x = r * std::cos(theta);
-        float y = r * std::sin(theta);
+layout(location = 0) in vec2 pos;
+layout(location = 1) in vec4 transform; // trans.xy, scale, theta
+layout(location = 2) in vec4 color;
 
-        vert.push_back(glm::vec2{x, y});
+uniform mat4 ortho_matrix;
+
+out vec4 instance_color;
+
+void main() {
+    float c = cos(transform.w);
+    float s = sin(transform.w);
+    mat2 rotation = mat2(c, s, -s, c);
+
+    instance_color = color;
+    gl_Position = ortho_matrix * vec4(rotation*pos*transform.z + transform.xy, 0.0, 1.0);
+})";
+
+const char *instanced_fragment_shader = R"(#version 300 es
+precision mediump float;
+
+in vec4 instance_color;
+out vec4 frag_color;
+
+void main() {
+    frag_color = instance_color;
+})";
+
+const char *sdf_vertex_shader = R"(#version 300 es
+precision highp float;
+
+layout(location = 0) in vec2 pos; // unit quad corner
+
+uniform vec2 bbox_min; // local units, padded for the line and anti-aliasing
+uniform vec2 bbox_max;
+uniform float scale;
+uniform float theta;
+uniform vec2 trans;
+uniform mat4 ortho_matrix;
+
+out vec2 local;
+
+void main() {
+    float c = cos(theta);
+    float s = sin(theta);
+    mat2 rotation = mat2(c, s, -s, c);
+
+    local = mix(bbox_min, bbox_max, pos);
+    gl_Position = ortho_matrix * vec4(rotation*local*scale + trans, 0.0, 1.0);
+})";
+
+// Colors are straight alpha, the line is composited over the fill.
+const char *sdf_fragment_shader = R"(#version 300 es
+precision highp float;
+
+#define MAX_VERTICES 32
+
+in vec2 local;
+
+uniform int kind; // 0 polygon, 1 circle, 2 rounded rect
+uniform vec2 vert[MAX_VERTICES];
+uniform int vert_count;
+uniform vec2 half_size;
+uniform float radius;
+
+uniform vec4 fill_color;
+uniform vec4 line_color;
+uniform float half_width;
+
+out vec4 frag_color;
+
+// negative inside, either winding, from Inigo Quilez
+float sd_polygon(vec2 p) {
+    float d = dot(p - vert[0], p - vert[0]);
+    float s = 1.0;
+
+    for (int i = 0, j = vert_count - 1; i < vert_count; j = i, i++) {
+        vec2 e = vert[j] - vert[i];
+        vec2 w = p - vert[i];
+        vec2 b = w - e * clamp(dot(w, e) / dot(e, e), 0.0, 1.0);
+        d = min(d, dot(b, b));
+
+        bvec3 c = bvec3(p.y >= vert[i].y, p.y < vert[j].y, e.x * w.y > e.y * w.x);
+        if (all(c) || all(not(c))) {
+            s = -s;
+        }
     }
 
-    return vert;
+    return s * sqrt(d);
 }
 
-VertexIndex make_fill(const std::vector<glm::vec2> &vert) {
-    std::vector<glm::vec2> fill_vert;
-    std::vector<uint32_t> fill_idx;
+float sd_rounded_rect(vec2 p) {
+    vec2 q = abs(p) - half_size + radius;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+}
 
-    fill_vert = vert;
-    fill_vert.push_back(glm::vec2{0.0f, 0.0f});  // cener of shape
+void main() {
+    float d;
+    if (kind == 0) {
+        d = sd_polygon(local);
+    } else if (kind == 1) {
+        d = length(local) - radius;
+    } else {
+        d = sd_rounded_rect(local);
+    }
 
-    for (size_t i = 0; i < vert.size(); i++) {
-        uint32_t j = static_cast<uint32_t>((i + 1) % vert.size());
+    // one pixel wide ramp centered on the edge
+    float aa = max(fwidth(d), 1e-6);
+    float fill = fill_color.a * clamp(0.5 - d / aa, 0.0, 1.0);
+    float line = line_color.a * clamp(0.5 - (abs(d) - half_width) / aa, 0.0, 1.0);
 
-        fill_idx.push_back(static_cast<uint32_t>(i));
-        fill_idx.push_back(j);
-        fill_idx.push_back(static_cast<uint32_t>(fill_vert.size() - 1));
+    float a = line + fill * (1.0 - line);
+    if (a <= 0.0) {
+        discard;
     }
 
-    return {fill_vert, fill_idx};
-}
+    frag_color = vec4((line_color.rgb * line + fill_color.rgb * fill * (1.0 - line)) / a, a);
+})";
 
-VertexIndex make_line(const std::vector<glm::vec2> &vert, float thickness) {
-    // quads for each line
-    std::vector<glm::vec2> tri_pts;
-    std::vector<uint32_t> tri_idx;
-    std::vector<glm::vec2> inner, outer;
+enum class PrimitiveKind : uint32_t { fill, line };
 
-    for (size_t i = 0; i < vert.size(); i++) {
-        size_t j = (i + 1) % vert.size();
+struct GeometryKey {
+    PrimitiveKind kind;
+    float thickness;
+    std::vector<glm::vec2> vert;
 
-        glm::vec2 v = vert[j] - vert[i];
-        v /= glm::length(v);
+    bool operator==(const GeometryKey &o) const {
+        return kind == o.kind && thickness == o.thickness && vert == o.vert;
+    }
+};
+
+struct GeometryKeyHash {
+    size_t operator()(const GeometryKey &k) const {
+        uint64_t h = 0xcbf29ce484222325ull;
 
-        // normal to the line
-        glm::vec2 n{-v[1], v[0]};
+        auto mix = [&](const void *data, size_t bytes) {
+            const unsigned char *p = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < bytes; i++) {
+                h ^= p[i];
+                h *= 0x100000001b3ull;
+            }
+        };
 
-        uint32_t idx = static_cast<uint32_t>(tri_pts.size());
+        mix(&k.kind, sizeof(k.kind));
+        mix(&k.thickness, sizeof(k.thickness));
+        mix(k.vert.data(), k.vert.size() * sizeof(glm::vec2));
+
+        return static_cast<size_t>(h);
+    }
+};
 
-        tri_idx.push_back(idx + 0);
-        tri_idx.push_back(idx + 1);
-        tri_idx.push_back(idx + 2);
-        tri_idx.push_back(idx + 0);
-        tri_idx.push_back(idx + 2);
-        tri_idx.push_back(idx + 3);
+// Identical geometry shares one buffer. Entries only hold weak references,
+// the buffer is freed when the last shape drops it.
+std::unordered_map<GeometryKey, std::weak_ptr<VertexBuffer>, GeometryKeyHash> geometry_cache;
+ShapeStats stats;
 
-        tri_pts.push_back(vert[i] + n * thickness * 0.5f);
-        tri_pts.push_back(vert[j] + n * thickness * 0.5f);
-        tri_pts.push_back(vert[j] - n * thickness * 0.5f);
-        tri_pts.push_back(vert[i] - n * thickness * 0.5f);
+std::shared_ptr<VertexBuffer> get_geometry(PrimitiveKind kind, const std::vector<glm::vec2> &vert, float thickness) {
+    GeometryKey key{kind, thickness, vert};
 
-        outer.push_back(vert[i] + n * thickness * 0.5f);
-        outer.push_back(vert[j] + n * thickness * 0.5f);
-        inner.push_back(vert[j] - n * thickness * 0.5f);
-        inner.push_back(vert[i] - n * thickness * 0.5f);
+    auto it = geometry_cache.find(key);
+    if (it != geometry_cache.end()) {
+        if (auto v = it->second.lock()) {
+            stats.cache_hits++;
+            return v;
+        }
     }
 
-    // miter
-    for (size_t i = 0; i < vert.size(); i++) {
-        size_t j = (i + 1) % vert.size();
+    stats.cache_misses++;
 
-        for (const auto &pts : {inner, outer}) {
-            glm::vec2 p0 = pts[i * 2];
-            glm::vec2 p1 = pts[i * 2 + 1];
-            glm::vec2 p2 = pts[j * 2];
-            glm::vec2 p3 = pts[j * 2 + 1];
+    // the cache is only used from the thread that draws, the arena keeps its capacity between shapes
+    static TessArena arena;
+    arena.clear();
 
-            glm::vec2 v0 = p1 - p0;
-            glm::vec2 v1 = p3 - p2;
+    if (kind == PrimitiveKind::fill) {
+        fill_polygon(arena, vert.data(), vert.size());
+    } else {
+        StrokeStyle style;
+        style.width = thickness;
+        stroke_polyline(arena, vert.data(), vert.size(), style);
+    }
 
-            // find intersection of 2 lines
-            // Ax = b
-            // A = [v0 | -v1]
-            // b = p2 - p0
-            // use Cramer's rule
+    VertexBufferPtr buffer = make_vertex_buffer(arena.vertex, arena.index);
+    uint64_t bytes = buffer->vertex_bytes + buffer->index_bytes();
 
-            glm::vec2 b = p2 - p0;
+    stats.bytes += bytes;
+    stats.buffers++;
 
-            double det = v0[0] * (-v1[1]) - (-v1[0] * v0[1]);
-            double c0 = b[0] * (-v1[1]) - (-v1[0] * b[1]);
-            float t0 = static_cast<float>(c0 / det);
+    auto deleter = buffer.get_deleter();
+    std::shared_ptr<VertexBuffer> shared(buffer.release(), [deleter, bytes](VertexBuffer *v) {
+        stats.bytes -= bytes;
+        stats.buffers--;
+        deleter(v);
+    });
 
-            glm::vec2 pp = p0 + v0 * t0;
+    // drop entries whose buffers are gone before adding, keeps the map from growing without bound
+    for (auto e = geometry_cache.begin(); e != geometry_cache.end();) {
+        e = e->second.expired() ? geometry_cache.erase(e) : std::next(e);
+    }
 
-            uint32_t idx = static_cast<uint32_t>(tri_pts.size());
+    geometry_cache[std::move(key)] = shared;
 
-            tri_idx.push_back(idx + 0);
-            tri_idx.push_back(idx + 1);
-            tri_idx.push_back(idx + 2);
-            tri_idx.push_back(idx + 0);
-            tri_idx.push_back(idx + 1);
-            tri_idx.push_back(idx + 3);
+    return shared;
+}
+}  // namespace
 
-            tri_pts.push_back(vert[j]);
-            tri_pts.push_back(pp);
-            tri_pts.push_back(p1);
-            tri_pts.push_back(p2);
-        }
+std::vector<glm::vec2> make_polygon(int sides, const std::vector<float> &radius) {
+    std::vector<glm::vec2> vert;
+
+    for (int i = 0; i < sides; i++) {
+        float theta = static_cast<float>(i * 2 * M_PI / sides);
+        float r = radius[static_cast<size_t>(i) % radius.size()];
+        float x = r * std::cos(theta);
+        float y = r * std::sin(theta);
+
+        vert.push_back(glm::vec2{x, y});
     }
 
-    return {tri_pts, tri_idx};
+    return vert;
+}
+
+VertexIndex make_fill(const std::vector<glm::vec2> &vert) {
+    TessArena arena;
+    fill_polygon(arena, vert.data(), vert.size());
+
+    return {std::move(arena.vertex), std::move(arena.index)};
+}
+
+VertexIndex make_line(const std::vector<glm::vec2> &vert, float thickness) {
+    TessArena arena;
+
+    StrokeStyle style;
+    style.width = thickness;
+    stroke_polyline(arena, vert.data(), vert.size(), style);
+
+    return {std::move(arena.vertex), std::move(arena.index)};
 }
 
 Shape make_shape(const std::vector<glm::vec2> &vert,
                  float line_thickness,
                  const glm::vec4 &line_color,
                  const glm::vec4 &fill_color) {
+    // no GL work here, the primitives are built by draw_shape
     Shape shape;
-    {
-        auto [vertex, index] = make_fill(vert);
-        shape.fill.vertex_buffer = make_vertex_buffer(vertex, index);
-        shape.fill.color = fill_color;
-    }
 
-    {
-        auto [vertex, index] = make_line(vert, line_thickness);
-        shape.line.vertex_buffer = make_vertex_buffer(vertex, index);
-        shape.line.color = line_color;
-    }
-
-    {
-        auto [vertex, index] = make_line(vert, line_thickness * 2);
-        shape.line_highlight.vertex_buffer = make_vertex_buffer(vertex, index);
-        shape.line_highlight.color = line_color;
-    }
+    shape.vert = vert;
+    shape.line_thickness = line_thickness;
+    shape.fill.color = fill_color;
+    shape.line.color = line_color;
+    shape.line_highlight.color = line_color;
 
     shape.bbox.start = glm::vec2{-1.f, -1.f};
     shape.bbox.end = glm::vec2{1.f, 1.f};
@@ -182,18 +300,32 @@ Shape make_shape(const std::vector<glm::vec2> &vert,
     return shape;
 }
 
+void Shape::release() {
+    fill.vertex_buffer.reset();
+    line.vertex_buffer.reset();
+    line_highlight.vertex_buffer.reset();
+}
+
+const ShapeStats &shape_stats() { return stats; }
+
 bool ShapeShader::init() {
     shader = make_shader(vertex_shader, fragment_shader);
-    if (shader) {
-        return true;
-    }
-    return false;
+    instanced_shader = make_shader(instanced_vertex_shader, instanced_fragment_shader);
+    sdf_shader = make_shader(sdf_vertex_shader, sdf_fragment_shader);
+
+    std::vector<glm::vec2> corner{{0.f, 0.f}, {1.f, 0.f}, {1.f, 1.f}, {0.f, 1.f}};
+    sdf_quad = make_vertex_buffer(corner, {0, 1, 2, 0, 2, 3});
+
+    return true;
 }
 
 void ShapeShader::set_ortho(const glm::mat4 &ortho) {
-    assert(shader);
-    shader->use();
-    glUniformMatrix4fv(shader->get_loc("ortho_matrix"), 1, GL_FALSE, glm::value_ptr(ortho));
+    assert(shader && instanced_shader && sdf_shader);
+
+    for (const ShaderPtr *s : {&shader, &instanced_shader, &sdf_shader}) {
+        (*s)->use();
+        glUniformMatrix4fv((*s)->get_loc("ortho_matrix"), 1, GL_FALSE, glm::value_ptr(ortho));
+    }
 }
 
 glm::vec2 normalize_pos_to_screen_pos(const ShapeShader &shader, const glm::vec2 &pos) {
@@ -204,7 +336,24 @@ glm::vec2 screen_pos_to_normalize_pos(const ShapeShader &shader, const glm::vec2
     return (pos - shader.draw_area_offset) / shader.draw_area_size.x;
 }
 
-void draw_shape(const ShapeShader &shape_shader, const Shape &shape, bool fill, bool line, bool line_highlight) {
+ShapePrimitive &shape_primitive(Shape &shape, ShapePart part) {
+    ShapePrimitive &prim = part == ShapePart::fill ? shape.fill
+                           : part == ShapePart::line ? shape.line
+                                                     : shape.line_highlight;
+
+    if (!prim.vertex_buffer) {
+        if (part == ShapePart::fill) {
+            prim.vertex_buffer = get_geometry(PrimitiveKind::fill, shape.vert, 0.f);
+        } else {
+            float thickness = part == ShapePart::line ? shape.line_thickness : shape.line_thickness * 2;
+            prim.vertex_buffer = get_geometry(PrimitiveKind::line, shape.vert, thickness);
+        }
+    }
+
+    return prim;
+}
+
+void draw_shape(const ShapeShader &shape_shader, Shape &shape, bool fill, bool line, bool line_highlight) {
     const ShaderPtr &s = shape_shader.shader;
 
     s->use();
@@ -213,18 +362,118 @@ void draw_shape(const ShapeShader &shape_shader, const Shape &shape, bool fill,
     glUniform1f(s->get_loc("theta"), shape.theta);
     glUniform2fv(s->get_loc("trans"), 1, glm::value_ptr(shape.trans));
 
+    auto draw = [&](ShapePart part) {
+        const ShapePrimitive &prim = shape_primitive(shape, part);
+
+        glUniform4fv(s->get_loc("color"), 1, glm::value_ptr(prim.color));
+        draw_vertex_buffer(s, *prim.vertex_buffer, {{}, {}}, prim.vertex_buffer->index_count);
+    };
+
     if (fill) {
-        glUniform4fv(s->get_loc("color"), 1, glm::value_ptr(shape.fill.color));
-        draw_vertex_buffer(s, shape.fill.vertex_buffer);
+        draw(ShapePart::fill);
     }
 
     if (line) {
-        glUniform4fv(s->get_loc("color"), 1, glm::value_ptr(shape.line.color));
-        draw_vertex_buffer(s, shape.line.vertex_buffer);
+        draw(ShapePart::line);
     }
 
     if (line_highlight) {
-        glUniform4fv(s->get_loc("color"), 1, glm::value_ptr(shape.line_highlight.color));
-        draw_vertex_buffer(s, shape.line_highlight.vertex_buffer);
+        draw(ShapePart::line_highlight);
     }
 }
+
+bool make_sdf_polygon(const std::vector<glm::vec2> &vert,
+                      float line_thickness,
+                      const glm::vec4 &line_color,
+                      const glm::vec4 &fill_color,
+                      SdfShape &shape) {
+    if (vert.empty() || vert.size() > SDF_MAX_VERTICES) {
+        LOG("SDF polygon needs 1 to %d vertices, got %d",
+            static_cast<int>(SDF_MAX_VERTICES),
+            static_cast<int>(vert.size()));
+        return false;
+    }
+
+    shape = SdfShape{};
+    shape.kind = SdfKind::polygon;
+    shape.vert = vert;
+    shape.line_thickness = line_thickness;
+    shape.line_color = line_color;
+    shape.fill_color = fill_color;
+
+    shape.bbox_min = shape.bbox_max = vert[0];
+    for (const glm::vec2 &v : vert) {
+        shape.bbox_min = glm::min(shape.bbox_min, v);
+        shape.bbox_max = glm::max(shape.bbox_max, v);
+    }
+
+    return true;
+}
+
+SdfShape make_sdf_circle(float radius, float line_thickness, const glm::vec4 &line_color, const glm::vec4 &fill_color) {
+    SdfShape shape;
+    shape.kind = SdfKind::circle;
+    shape.radius = radius;
+    shape.line_thickness = line_thickness;
+    shape.line_color = line_color;
+    shape.fill_color = fill_color;
+    shape.bbox_min = glm::vec2{-radius};
+    shape.bbox_max = glm::vec2{radius};
+
+    return shape;
+}
+
+SdfShape make_sdf_rounded_rect(const glm::vec2 &half_size,
+                               float corner_radius,
+                               float line_thickness,
+                               const glm::vec4 &line_color,
+                               const glm::vec4 &fill_color) {
+    SdfShape shape;
+    shape.kind = SdfKind::rounded_rect;
+    shape.half_size = half_size;
+    shape.radius = std::min({corner_radius, half_size.x, half_size.y});
+    shape.line_thickness = line_thickness;
+    shape.line_color = line_color;
+    shape.fill_color = fill_color;
+    shape.bbox_min = -half_size;
+    shape.bbox_max = half_size;
+
+    return shape;
+}
+
+void draw_sdf_shape(const ShapeShader &shape_shader, const SdfShape &shape, bool fill, bool line, bool line_highlight) {
+    const ShaderPtr &s = shape_shader.sdf_shader;
+
+    // same widths as the tessellated strokes, the line is centered on the outline
+    bool any_line = (line || line_highlight) && shape.line_thickness > 0.f;
+    float half_width = any_line ? shape.line_thickness * (line_highlight ? 1.f : 0.5f) : 0.f;
+
+    // room for the line and the anti-aliasing ramp, 2 pixels in local units
+    float px = 1.f / std::max(shape_shader.draw_area_size.x * shape.scale, 1e-6f);
+    glm::vec2 pad{half_width + 2.f * px};
+
+    glm::vec4 no_color{0.f};
+
+    s->use();
+
+    glUniform1f(s->get_loc("scale"), shape.scale);
+    glUniform1f(s->get_loc("theta"), shape.theta);
+    glUniform2fv(s->get_loc("trans"), 1, glm::value_ptr(shape.trans));
+    glUniform2fv(s->get_loc("bbox_min"), 1, glm::value_ptr(shape.bbox_min - pad));
+    glUniform2fv(s->get_loc("bbox_max"), 1, glm::value_ptr(shape.bbox_max + pad));
+
+    glUniform1i(s->get_loc("kind"), static_cast<int>(shape.kind));
+    glUniform2fv(s->get_loc("half_size"), 1, glm::value_ptr(shape.half_size));
+    glUniform1f(s->get_loc("radius"), shape.radius);
+
+    if (shape.kind == SdfKind::polygon && !shape.vert.empty()) {
+        glUniform1i(s->get_loc("vert_count"), static_cast<int>(shape.vert.size()));
+        glUniform2fv(s->get_loc("vert"), static_cast<GLsizei>(shape.vert.size()), glm::value_ptr(shape.vert[0]));
+    }
+
+    glUniform4fv(s->get_loc("fill_color"), 1, glm::value_ptr(fill ? shape.fill_color : no_color));
+    glUniform4fv(s->get_loc("line_color"), 1, glm::value_ptr(any_line ? shape.line_color : no_color));
+    glUniform1f(s->get_loc("half_width"), half_width);
+
+    draw_vertex_buffer(s, *shape_shader.sdf_quad, {{}, {}}, shape_shader.sdf_quad->index_count);
+}
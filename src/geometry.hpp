@@ -1,13 +1,18 @@
+#pragma once
+
 // #include <SDL3/SDL_opengles2.h>
 
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 
 #include "gl_helper.hpp"
 
-// Wrapper for GL_TRIANGLES
+// Wrapper for GL_TRIANGLES.
+// The buffer is built on first draw and shared with every shape of the same geometry.
 struct ShapePrimitive {
-    VertexBufferPtr vertex_buffer{{}, {}};
+    std::shared_ptr<VertexBuffer> vertex_buffer;
     glm::vec4 color{};
 };
 
@@ -16,6 +21,10 @@ struct Shape {
 
     float rotation_direction = 1.f;
 
+    // outline the primitives are tessellated from
+    std::vector<glm::vec2> vert;
+    float line_thickness = 0.f;
+
     ShapePrimitive line;
     ShapePrimitive line_highlight;
     ShapePrimitive fill;
@@ -23,10 +32,55 @@ struct Shape {
     glm::vec2 trans{};
     float scale = 1.0f;
     float theta = 0.0f;  // rotation in radians
+
+    // Drops this shape's references, buffers no other shape uses are freed.
+    // They're rebuilt on the next draw.
+    void release();
+};
+
+// GPU memory held by shape primitives, a buffer shared by several shapes counts once.
+struct ShapeStats {
+    uint64_t bytes = 0;
+    uint64_t buffers = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+};
+
+const ShapeStats &shape_stats();
+
+// Analytic shapes, drawn as one quad each. The fragment shader evaluates the signed distance to the outline
+// and anti-aliases it with the screen space derivative, so no MSAA is needed. Fill, line and highlight are
+// uniforms, changing them never rebuilds geometry.
+enum class SdfKind : int { polygon = 0, circle = 1, rounded_rect = 2 };
+
+// Polygons are passed as a uniform array.
+constexpr size_t SDF_MAX_VERTICES = 32;
+
+struct SdfShape {
+    SdfKind kind = SdfKind::polygon;
+
+    std::vector<glm::vec2> vert;  // polygon, at most SDF_MAX_VERTICES
+    glm::vec2 half_size{};        // rounded_rect, centered on the origin
+    float radius = 0.f;           // circle radius or rect corner radius
+
+    float line_thickness = 0.f;
+    glm::vec4 line_color{};
+    glm::vec4 fill_color{};
+
+    glm::vec2 trans{};
+    float scale = 1.0f;
+    float theta = 0.0f;  // rotation in radians
+
+    // local bounding box of the outline
+    glm::vec2 bbox_min{};
+    glm::vec2 bbox_max{};
 };
 
 struct ShapeShader {
     ShaderPtr shader{{}, {}};
+    ShaderPtr instanced_shader{{}, {}};  // see ShapeBatch
+    ShaderPtr sdf_shader{{}, {}};
+    VertexBufferPtr sdf_quad{{}, {}};
     glm::vec2 draw_area_offset;
     glm::vec2 draw_area_size;
 
@@ -39,15 +93,42 @@ struct VertexIndex {
     std::vector<uint32_t> index;
 };
 
-void draw_shape(const ShapeShader &shape_shader, const Shape &shape, bool fill, bool line, bool line_highlight);
+enum class ShapePart { fill, line, line_highlight };
+
+// The primitive for part, its buffer is built on first use. Needs the GL context.
+ShapePrimitive &shape_primitive(Shape &shape, ShapePart part);
+
+// Builds the requested primitives on first use, needs the GL context.
+void draw_shape(const ShapeShader &shape_shader, Shape &shape, bool fill, bool line, bool line_highlight);
 
 glm::vec2 normalize_pos_to_screen_pos(const ShapeShader &shader, const glm::vec2 &pos);
 glm::vec2 screen_pos_to_normalize_pos(const ShapeShader &shader, const glm::vec2 &pos);
 
+// Regular polygon with a radius of 1, radius cycles through the list per vertex (alternate them for a star).
+std::vector<glm::vec2> make_polygon(int sides, const std::vector<float> &radius);
+
 VertexIndex make_fill(const std::vector<glm::vec2> &vert);
 VertexIndex make_line(const std::vector<glm::vec2> &vert, float thickness);
 
+// Triangulated shape. The app's own shapes are SdfShape, this is for polygons past SDF_MAX_VERTICES and
+// is only drawn by the shapes and shape_batch bench scenes.
 Shape make_shape(const std::vector<glm::vec2> &vert,
                  float line_thickness,
                  const glm::vec4 &line_color,
                  const glm::vec4 &fill_color);
+
+// False when the polygon has more than SDF_MAX_VERTICES.
+bool make_sdf_polygon(const std::vector<glm::vec2> &vert,
+                      float line_thickness,
+                      const glm::vec4 &line_color,
+                      const glm::vec4 &fill_color,
+                      SdfShape &shape);
+SdfShape make_sdf_circle(float radius, float line_thickness, const glm::vec4 &line_color, const glm::vec4 &fill_color);
+SdfShape make_sdf_rounded_rect(const glm::vec2 &half_size,
+                               float corner_radius,
+                               float line_thickness,
+                               const glm::vec4 &line_color,
+                               const glm::vec4 &fill_color);
+
+// One draw call whatever is enabled, the highlight is a line of twice the thickness.
+void draw_sdf_shape(const ShapeShader &shape_shader, const SdfShape &shape, bool fill, bool line, bool line_highlight);
@@ -1,21 +1,50 @@
 #define GL_GLEXT_PROTOTYPES
 #include "gl_helper.hpp"
 
+#include <SDL3/SDL_iostream.h>
 #include <SDL3/SDL_opengles2.h>
 #include <SDL3/SDL_surface.h>
+#include <SDL3/SDL_video.h>
+#include <SDL3/SDL_timer.h>
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
 #include <vector>
 
 #include "log.hpp"
+#include "shader_cache.hpp"
+#include "trace.hpp"
 
 namespace {
-bool compile_shader(GLuint s, const char *shader) {
-    GLint length = static_cast<GLint>(strlen(shader));
-    glShaderSource(s, 1, static_cast<const GLchar **>(&shader), &length);
+void log_numbered_source(const char *code) {
+    std::string line;
+    int n = 1;
+
+    for (const char *p = code;; p++) {
+        if (*p == '\n' || *p == '\0') {
+            LOG("%4d: %s", n++, line.c_str());
+            line.clear();
+
+            if (*p == '\0') {
+                break;
+            }
+        } else {
+            line += *p;
+        }
+    }
+}
+
+bool parallel_compile = false;
+
+void submit_shader(GLuint s, const std::string &code) {
+    const GLchar *str = code.c_str();
+    GLint length = static_cast<GLint>(code.size());
+    glShaderSource(s, 1, &str, &length);
     glCompileShader(s);
+}
 
+bool check_compile(GLuint s, const std::string &code, const char *stage) {
     GLint status = 0;
     glGetShaderiv(s, GL_COMPILE_STATUS, &status);
 
@@ -23,12 +52,13 @@ bool compile_shader(GLuint s, const char *shader) {
         GLint len = 0;
         glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
 
-        std::vector<GLchar> error(static_cast<size_t>(len));
+        std::vector<GLchar> error(static_cast<size_t>(std::max(len, 1)));
         glGetShaderInfoLog(s, len, &len, error.data());
 
-        if (len > 0) {
-            LOG("compile_shader error: %s", error.data());
-        }
+        LOG("compile_shader error (%s): %s", stage, len > 0 ? error.data() : "(no info log)");
+
+        // line numbers in the error refer to the source with defines inserted
+        log_numbered_source(code.c_str());
 
         return false;
     }
@@ -36,6 +66,96 @@ bool compile_shader(GLuint s, const char *shader) {
     return true;
 }
 
+bool check_link(GLuint program) {
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+    if (status == GL_FALSE) {
+        GLint len = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+
+        std::vector<GLchar> error(static_cast<size_t>(std::max(len, 1)));
+        glGetProgramInfoLog(program, len, &len, error.data());
+
+        LOG("link_program error: %s", len > 0 ? error.data() : "(no info log)");
+
+        return false;
+    }
+
+    return true;
+}
+
+// #version has to stay the first line
+std::string add_defines(const char *code, const std::vector<std::string> &defines) {
+    std::string str(code);
+
+    if (defines.empty()) {
+        return str;
+    }
+
+    size_t pos = 0;
+    if (str.rfind("#version", 0) == 0) {
+        pos = str.find('\n') + 1;
+    }
+
+    std::string def;
+    for (const auto &d : defines) {
+        def += "#define " + d + "\n";
+    }
+
+    str.insert(pos, def);
+
+    return str;
+}
+
+// Creates the VAO and vertex buffer, leaves the VAO bound for the caller to attach the index buffer.
+VertexBufferPtr make_vertex_array(const void *vertex, size_t vertex_bytes, const VertexLayout &layout) {
+    auto cleanup = [](VertexBuffer *v) {
+        LOG("deleting vertex array, vertex and index buffer: %d %d(%d bytes) %d(%d bytes%s)",
+            v->vao,
+            v->vertex,
+            static_cast<int>(v->vertex_bytes),
+            v->index,
+            static_cast<int>(v->index_bytes()),
+            v->shared_index ? ", shared" : "");
+        glDeleteVertexArraysOES(1, &v->vao);
+        glDeleteBuffers(1, &v->vertex);
+
+        if (!v->shared_index) {
+            glDeleteBuffers(1, &v->index);
+        }
+
+        delete v;
+    };
+
+    VertexBufferPtr v(new VertexBuffer, cleanup);
+
+    // The element array binding is part of the vertex array state, so bind the VAO first.
+    glGenVertexArraysOES(1, &v->vao);
+    glBindVertexArrayOES(v->vao);
+    v->layout = layout;
+
+    glGenBuffers(1, &v->vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, v->vertex);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertex_bytes), vertex, GL_DYNAMIC_DRAW);
+    v->vertex_bytes = vertex_bytes;
+
+    for (size_t i = 0; i < layout.attrib.size(); i++) {
+        const VertexAttrib &a = layout.attrib[i];
+
+        if (a.size == 0) {
+            continue;
+        }
+
+        GLuint loc = static_cast<GLuint>(i);
+        glEnableVertexAttribArray(loc);
+        glVertexAttribPointer(
+            loc, a.size, a.type, a.normalized, layout.stride, reinterpret_cast<const void *>(a.offset));
+    }
+
+    return v;
+}
+
 #ifdef __linux__
 void debug_callback(GLenum source,
                     GLenum type,
@@ -67,88 +187,440 @@ void enable_gl_debug_callback() {
 #endif
 }
 
-void VertexArray::use() { glBindVertexArrayOES(vao); }
+uint16_t pack_unorm16(float v) { return static_cast<uint16_t>(std::clamp(v, 0.f, 1.f) * 65535.f + 0.5f); }
 
-VertexArrayPtr make_vertex_array() {
-    auto cleanup = [](VertexArray *v) {
-        LOG("deleting vertex array: %d", v->vao);
-        glDeleteVertexArraysOES(1, &v->vao);
-    };
+bool has_gl_extension(const char *name) {
+    const char *ext = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
 
-    VertexArrayPtr v(new VertexArray, cleanup);
+    if (!ext) {
+        return false;
+    }
 
-    glGenVertexArraysOES(1, &v->vao);
+    size_t len = strlen(name);
 
-    return v;
+    for (const char *p = strstr(ext, name); p; p = strstr(p + len, name)) {
+        bool start = (p == ext || p[-1] == ' ');
+        bool end = (p[len] == ' ' || p[len] == '\0');
+
+        if (start && end) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void Shader::use() const { glUseProgram(program); }
+void Shader::use() const {
+    wait();
+    glUseProgram(program);
+}
 
 GLint Shader::get_loc(const char *name) const {
+    wait();
     GLint ret = glGetUniformLocation(program, name);
     // assert(ret >= 0);
     return ret;
 }
 
-ShaderPtr make_shader(const char *vertex_code, const char *fragment_code) {
+bool Shader::wait() const {
+    if (!pending) {
+        return !failed;
+    }
+
+    pending = false;
+
+    // polling first tells whether the driver finished while we did other work
+    GLint done = GL_FALSE;
+    if (parallel_compile) {
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+    }
+
+    uint64_t start = SDL_GetTicksNS();
+
+    // the status queries block until the driver is done
+    failed = !check_compile(vertex, vertex_src, "vertex") || !check_compile(fragment, fragment_src, "fragment") ||
+             !check_link(program);
+
+    vertex_src.clear();
+    vertex_src.shrink_to_fit();
+    fragment_src.clear();
+    fragment_src.shrink_to_fit();
+
+    if (failed) {
+        LOG("failed to build shader program %016llx", static_cast<unsigned long long>(cache_key));
+        return false;
+    }
+
+    // submit_ns also covers whatever ran between submit and first use, only the blocking part is saved
+    uint64_t now = SDL_GetTicksNS();
+    build_ns += now - start;
+    save_program_binary(program, cache_key, build_ns);
+
+    LOG("shader %016llx linked %.2f ms after submit, %s %.2f ms, %.2f ms on the GL thread",
+        static_cast<unsigned long long>(cache_key),
+        static_cast<double>(now - submit_ns) * 1e-6,
+        done ? "ready in background, polled in" : "blocked for",
+        static_cast<double>(now - start) * 1e-6,
+        static_cast<double>(build_ns) * 1e-6);
+
+    return true;
+}
+
+void init_parallel_shader_compile() {
+    if (!has_gl_extension("GL_KHR_parallel_shader_compile")) {
+        LOG("KHR_parallel_shader_compile not supported, shaders link on first use");
+        return;
+    }
+
+    // not every GLES library exports the KHR entry point, look it up at runtime
+    using MaxThreadsFn = void(GL_APIENTRYP)(GLuint);
+    auto max_threads = reinterpret_cast<MaxThreadsFn>(SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+
+    if (max_threads) {
+        // let the driver pick the thread count
+        max_threads(0xFFFFFFFFu);
+    }
+
+    parallel_compile = true;
+}
+
+ShaderPtr make_shader(const char *vertex_code, const char *fragment_code, const std::vector<std::string> &defines) {
     auto cleanup = [](Shader *s) {
         LOG("deleting shader: %d %d %d", s->program, s->vertex, s->fragment);
         glDeleteShader(s->vertex);
         glDeleteShader(s->fragment);
         glDeleteProgram(s->program);
+        delete s;
     };
 
     ShaderPtr s(new Shader, cleanup);
 
+    std::string vertex_src = add_defines(vertex_code, defines);
+    std::string fragment_src = add_defines(fragment_code, defines);
+
+    s->submit_ns = SDL_GetTicksNS();
+    s->cache_key = shader_cache_key(vertex_src, fragment_src);
     s->program = glCreateProgram();
-    s->vertex = glCreateShader(GL_VERTEX_SHADER);
-    s->fragment = glCreateShader(GL_FRAGMENT_SHADER);
 
-    if (!compile_shader(s->vertex, vertex_code)) {
-        LOG("failed to compile vertex shader");
-        return {{}, cleanup};
-    }
+    uint64_t compile_ns = 0;
 
-    if (!compile_shader(s->fragment, fragment_code)) {
-        LOG("failed to compile fragment shader");
-        return {{}, cleanup};
+    if (load_program_binary(s->program, s->cache_key, compile_ns)) {
+        uint64_t load_ns = SDL_GetTicksNS() - s->submit_ns;
+        LOG("shader %016llx loaded from cache in %.2f ms, saved %.2f ms",
+            static_cast<unsigned long long>(s->cache_key),
+            static_cast<double>(load_ns) * 1e-6,
+            (static_cast<double>(compile_ns) - static_cast<double>(load_ns)) * 1e-6);
+        return s;
     }
 
+    uint64_t build_start = SDL_GetTicksNS();
+
+    s->vertex = glCreateShader(GL_VERTEX_SHADER);
+    s->fragment = glCreateShader(GL_FRAGMENT_SHADER);
+
+    // no status queries here, they would force the driver to finish
+    submit_shader(s->vertex, vertex_src);
+    submit_shader(s->fragment, fragment_src);
+
     glAttachShader(s->program, s->vertex);
     glAttachShader(s->program, s->fragment);
     glLinkProgram(s->program);
 
+    // drivers without parallel compile may do the work right here
+    s->build_ns = SDL_GetTicksNS() - build_start;
+
+    // kept for the error report in wait()
+    s->vertex_src = std::move(vertex_src);
+    s->fragment_src = std::move(fragment_src);
+    s->pending = true;
+
     return s;
 }
 
-TexturePtr make_texture(const std::string &bmp_path) {
-    SDL_Surface *bmp = SDL_LoadBMP(bmp_path.c_str());
+SurfacePtr decode_bmp(std::span<const uint8_t> bmp_data, const std::string &name) {
+    TRACE_ZONE("bmp decode");
+
+    SurfacePtr bmp(SDL_LoadBMP_IO(SDL_IOFromConstMem(bmp_data.data(), bmp_data.size()), true), SDL_DestroySurface);
+
+    if (!bmp) {
+        LOG("Failed to load texture: %s", name.c_str());
+        return bmp;
+    }
+
+    if (bmp->format != SDL_PIXELFORMAT_RGB24 && bmp->format != SDL_PIXELFORMAT_BGR24) {
+        bmp.reset(SDL_ConvertSurface(bmp.get(), SDL_PIXELFORMAT_RGB24));
+
+        if (!bmp) {
+            LOG("Failed to convert texture: %s", name.c_str());
+        }
+    }
+
+    return bmp;
+}
+
+TexturePtr make_texture(const SDL_Surface &bmp, const std::string &name) {
+    TRACE_ZONE("texture upload");
+
+    uint64_t start = SDL_GetTicksNS();
+
+    // rows are padded to the surface pitch, GL has to skip the same padding
+    int row_bytes = bmp.w * 3;
+    int alignment = 0;
+
+    for (int a : {8, 4, 2, 1}) {
+        if ((row_bytes + a - 1) / a * a == bmp.pitch) {
+            alignment = a;
+            break;
+        }
+    }
+
+    if (!alignment) {
+        LOG("Unsupported pitch %d for texture: %s", bmp.pitch, name.c_str());
+        return {{}, {}};
+    }
+
+    auto cleanup = [](Texture *t) {
+        LOG("deleting texture: %d(%dx%d)", t->id, t->width, t->height);
+        glDeleteTextures(1, &t->id);
+        delete t;
+    };
+
+    TexturePtr t(new Texture, cleanup);
+
+    t->width = bmp.w;
+    t->height = bmp.h;
+    t->bytes = static_cast<size_t>(row_bytes) * static_cast<size_t>(bmp.h);
+
+    glGenTextures(1, &t->id);
+    glBindTexture(GL_TEXTURE_2D, t->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bmp.w, bmp.h, 0, GL_RGB, GL_UNSIGNED_BYTE, bmp.pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    LOG("texture %s: %dx%d RGB8, %zu KiB, 24 bits per texel, uploaded in %.2f ms",
+        name.c_str(),
+        t->width,
+        t->height,
+        t->bytes / 1024,
+        static_cast<double>(SDL_GetTicksNS() - start) * 1e-6);
+
+    return t;
+}
+
+TexturePtr make_texture(std::span<const uint8_t> bmp_data, const std::string &name) {
+    SurfacePtr bmp = decode_bmp(bmp_data, name);
+
     if (!bmp) {
-        LOG("Failed to load texture: %s", bmp_path.c_str());
         return {{}, {}};
     }
 
+    return make_texture(*bmp, name);
+}
+
+TexturePtr make_texture(int width, int height) {
     auto cleanup = [](Texture *t) {
         LOG("deleting texture: %d(%dx%d)", t->id, t->width, t->height);
         glDeleteTextures(1, &t->id);
+        delete t;
     };
 
     TexturePtr t(new Texture, cleanup);
 
-    t->width = bmp->w;
-    t->height = bmp->h;
+    t->width = width;
+    t->height = height;
+    t->bytes = static_cast<size_t>(width) * static_cast<size_t>(height) * 3;
 
     glGenTextures(1, &t->id);
     glBindTexture(GL_TEXTURE_2D, t->id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bmp->w, bmp->h, 0, GL_RGB, GL_UNSIGNED_BYTE, bmp->pixels);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    SDL_DestroySurface(bmp);
+    return t;
+}
+
+void update_texture(const Texture &tex, int x, int y, int width, int height, const uint8_t *rgb) {
+    TRACE_ZONE("texture update");
+
+    glBindTexture(GL_TEXTURE_2D, tex.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+TexturePtr make_compressed_texture(std::span<const uint8_t> ktx, const std::string &name) {
+#ifdef __EMSCRIPTEN__
+    // ETC2 needs WEBGL_compressed_texture_etc, which desktop browsers rarely have
+    (void)ktx;
+    (void)name;
+    return {{}, {}};
+#else
+    TRACE_ZONE("compressed texture upload");
+
+    static const uint8_t KTX_ID[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    struct KtxHeader {
+        uint8_t id[12];
+        uint32_t endianness;
+        uint32_t gl_type;
+        uint32_t gl_type_size;
+        uint32_t gl_format;
+        uint32_t gl_internal_format;
+        uint32_t gl_base_internal_format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+        uint32_t array_elements;
+        uint32_t faces;
+        uint32_t levels;
+        uint32_t key_value_bytes;
+    };
+
+    uint64_t start = SDL_GetTicksNS();
+
+    const uint8_t *data = ktx.data();
+    size_t size = ktx.size();
+
+    KtxHeader h;
+    bool ok = size >= sizeof(h);
+
+    if (ok) {
+        memcpy(&h, data, sizeof(h));
+        ok = memcmp(h.id, KTX_ID, sizeof(KTX_ID)) == 0 && h.endianness == 0x04030201 &&
+             h.gl_internal_format == GL_COMPRESSED_RGB8_ETC2 && h.faces == 1 && h.levels > 0 &&
+             h.width > 0 && h.height > 0;
+    }
+
+    if (!ok) {
+        LOG("unsupported KTX file: %s", name.c_str());
+        return {{}, {}};
+    }
+
+    auto cleanup = [](Texture *t) {
+        LOG("deleting texture: %d(%dx%d)", t->id, t->width, t->height);
+        glDeleteTextures(1, &t->id);
+        delete t;
+    };
+
+    TexturePtr t(new Texture, cleanup);
+
+    t->width = static_cast<int>(h.width);
+    t->height = static_cast<int>(h.height);
+
+    glGenTextures(1, &t->id);
+    glBindTexture(GL_TEXTURE_2D, t->id);
+
+    size_t offset = sizeof(h) + h.key_value_bytes;
+    int levels = 0;
+
+    for (uint32_t level = 0; level < h.levels; level++) {
+        uint32_t level_bytes = 0;
+
+        if (offset + sizeof(level_bytes) > size) {
+            break;
+        }
+
+        memcpy(&level_bytes, data + offset, sizeof(level_bytes));
+        offset += sizeof(level_bytes);
+
+        if (offset + level_bytes > size) {
+            break;
+        }
+
+        GLsizei level_w = std::max(1, t->width >> level);
+        GLsizei level_h = std::max(1, t->height >> level);
+
+        glCompressedTexImage2D(GL_TEXTURE_2D,
+                               static_cast<GLint>(level),
+                               GL_COMPRESSED_RGB8_ETC2,
+                               level_w,
+                               level_h,
+                               0,
+                               static_cast<GLsizei>(level_bytes),
+                               data + offset);
+
+        // image data is padded to 4 bytes
+        offset += (level_bytes + 3u) & ~3u;
+        t->bytes += level_bytes;
+        levels++;
+    }
+
+    if (levels == 0) {
+        LOG("truncated KTX file: %s", name.c_str());
+        return {{}, {}};
+    }
+
+    t->levels = levels;
+
+    // a truncated chain is still complete up to the last level we have
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // ETC2 RGB8 is 64 bits per 4x4 block
+    LOG("texture %s: %dx%d ETC2, %d mips, %zu KiB, 4 bits per texel, loaded in %.2f ms",
+        name.c_str(),
+        t->width,
+        t->height,
+        t->levels,
+        t->bytes / 1024,
+        static_cast<double>(SDL_GetTicksNS() - start) * 1e-6);
 
     return t;
+#endif
+}
+
+FramebufferPtr make_framebuffer(int width, int height) {
+    auto cleanup = [](Framebuffer *f) {
+        LOG("deleting framebuffer: %d", f->fbo);
+        glDeleteFramebuffers(1, &f->fbo);
+        delete f;
+    };
+
+    auto tex_cleanup = [](Texture *t) {
+        LOG("deleting texture: %d(%dx%d)", t->id, t->width, t->height);
+        glDeleteTextures(1, &t->id);
+        delete t;
+    };
+
+    FramebufferPtr f(new Framebuffer, cleanup);
+
+    f->color = TexturePtr(new Texture, tex_cleanup);
+    f->color->width = width;
+    f->color->height = height;
+
+    glGenTextures(1, &f->color->id);
+    glBindTexture(GL_TEXTURE_2D, f->color->id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLint prev_fbo = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo);
+
+    glGenFramebuffers(1, &f->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, f->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, f->color->id, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(prev_fbo));
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        LOG("framebuffer incomplete: 0x%x", status);
+        return {{}, cleanup};
+    }
+
+    return f;
 }
 
 void Texture::use() const {
@@ -157,80 +629,208 @@ void Texture::use() const {
 }
 
 VertexBufferPtr make_vertex_buffer(const std::vector<glm::vec2> &vertex, const std::vector<uint32_t> &index) {
-    return make_vertex_buffer(glm::value_ptr(vertex[0]), sizeof(glm::vec2) * vertex.size(), index);
+    return make_vertex_buffer(glm::value_ptr(vertex[0]), sizeof(glm::vec2) * vertex.size(), index, LAYOUT_POS);
 }
 
 VertexBufferPtr make_vertex_buffer(const std::vector<glm::vec4> &vertex, const std::vector<uint32_t> &index) {
-    return make_vertex_buffer(glm::value_ptr(vertex[0]), sizeof(glm::vec4) * vertex.size(), index);
+    return make_vertex_buffer(glm::value_ptr(vertex[0]), sizeof(glm::vec4) * vertex.size(), index, LAYOUT_POS_UV);
 }
 
-VertexBufferPtr make_vertex_buffer(const float *vertex, size_t vertex_bytes, const std::vector<uint32_t> &index) {
-    auto cleanup = [](VertexBuffer *v) {
-        LOG("deleting vertex and index buffer: %d(%d bytes) %d(%d count)",
-            v->vertex,
-            static_cast<int>(v->vertex_bytes),
-            v->index,
-            static_cast<int>(v->index_count));
-        glDeleteBuffers(1, &v->vertex);
-        glDeleteBuffers(1, &v->index);
-    };
+VertexBufferPtr make_vertex_buffer(const void *vertex,
+                                   size_t vertex_bytes,
+                                   const std::vector<uint32_t> &index,
+                                   const VertexLayout &layout) {
+    TRACE_ZONE("vertex buffer upload");
 
-    VertexBufferPtr v(new VertexBuffer, cleanup);
-
-    glGenBuffers(1, &v->vertex);
-    glBindBuffer(GL_ARRAY_BUFFER, v->vertex);
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertex_bytes), vertex, GL_DYNAMIC_DRAW);
-    v->vertex_bytes = vertex_bytes;
+    VertexBufferPtr v = make_vertex_array(vertex, vertex_bytes, layout);
 
     glGenBuffers(1, &v->index);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, v->index);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 static_cast<GLsizeiptr>(sizeof(uint32_t) * index.size()),
-                 index.data(),
-                 GL_STATIC_DRAW);
+
+    size_t vertex_count = vertex_bytes / static_cast<size_t>(layout.stride);
+    v->index_type = vertex_count <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
     v->index_count = index.size();
+    v->index_capacity = index.size();
+
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(v->index_bytes());
+
+    if (v->index_type == GL_UNSIGNED_SHORT) {
+        std::vector<uint16_t> index16(index.begin(), index.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, index16.data(), GL_STATIC_DRAW);
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, index.data(), GL_STATIC_DRAW);
+    }
+
+    glBindVertexArrayOES(0);
 
     return v;
 }
 
-void VertexBuffer::use() const {
-    glBindBuffer(GL_ARRAY_BUFFER, vertex);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index);
+VertexBufferPtr make_quad_vertex_buffer(QuadIndex &quad_index,
+                                        const void *vertex,
+                                        size_t vertex_bytes,
+                                        size_t quads,
+                                        const VertexLayout &layout) {
+    assert(quads <= MAX_QUADS);
+
+    TRACE_ZONE("vertex buffer upload");
+
+    VertexBufferPtr v = make_vertex_array(vertex, vertex_bytes, layout);
+
+    quad_index.bind(quads);
+    v->index = quad_index.id;
+    v->index_type = GL_UNSIGNED_SHORT;
+    v->index_count = quads * 6;
+    v->index_capacity = v->index_count;
+    v->shared_index = true;
+
+    glBindVertexArrayOES(0);
+
+    return v;
+}
+
+size_t VertexBuffer::index_bytes() const {
+    return index_count * (index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
 }
 
+void VertexBuffer::use() const { glBindVertexArrayOES(vao); }
+
 void VertexBuffer::update_vertex(const float *v, size_t v_bytes, const std::vector<uint32_t> &optional_idx) {
     glBindBuffer(GL_ARRAY_BUFFER, vertex);
     glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(v_bytes), v);
 
     if (!optional_idx.empty()) {
+        assert(!shared_index);
+
+        use();
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(optional_idx.size()), optional_idx.data());
+
         index_count = optional_idx.size();
+        GLsizeiptr bytes = static_cast<GLsizeiptr>(index_bytes());
+
+        std::vector<uint16_t> index16;
+        const void *data = optional_idx.data();
+
+        if (index_type == GL_UNSIGNED_SHORT) {
+            index16.assign(optional_idx.begin(), optional_idx.end());
+            data = index16.data();
+        }
+
+        if (index_count > index_capacity) {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+            index_capacity = index_count;
+        } else {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, bytes, data);
+        }
+    }
+}
+
+void VertexBuffer::stream_vertex(const void *v, size_t v_bytes) {
+    assert(v_bytes <= vertex_bytes);
+    TRACE_ZONE("vertex stream upload");
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertex);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertex_bytes), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(v_bytes), v);
+}
+
+QuadIndexPtr make_quad_index() {
+    auto cleanup = [](QuadIndex *q) {
+        LOG("deleting quad index buffer: %d(%d quads)", q->id, static_cast<int>(q->quads));
+        glDeleteBuffers(1, &q->id);
+        delete q;
+    };
+
+    QuadIndexPtr q(new QuadIndex, cleanup);
+    glGenBuffers(1, &q->id);
+
+    return q;
+}
+
+void QuadIndex::bind(size_t min_quads) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+
+    if (min_quads <= quads) {
+        return;
+    }
+
+    quads = std::max<size_t>(quads * 2, 256);
+    quads = std::min(std::max(quads, min_quads), MAX_QUADS);
+
+    std::vector<uint16_t> idx;
+    idx.reserve(quads * 6);
+
+    for (size_t i = 0; i < quads; i++) {
+        uint16_t k = static_cast<uint16_t>(i * 4);
+
+        for (int j : {0, 1, 2, 0, 2, 3}) {
+            idx.push_back(static_cast<uint16_t>(k + j));
+        }
+    }
+
+    glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(uint16_t) * idx.size()), idx.data(), GL_STATIC_DRAW);
+
+    LOG("quad index buffer: %d quads, %d bytes",
+        static_cast<int>(quads),
+        static_cast<int>(sizeof(uint16_t) * idx.size()));
+}
+
+BufferPtr make_buffer(size_t bytes) {
+    auto cleanup = [](Buffer *b) {
+        LOG("deleting buffer: %d(%d bytes)", b->id, static_cast<int>(b->bytes));
+        glDeleteBuffers(1, &b->id);
+        delete b;
+    };
+
+    BufferPtr b(new Buffer, cleanup);
+
+    glGenBuffers(1, &b->id);
+    glBindBuffer(GL_ARRAY_BUFFER, b->id);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+    b->bytes = bytes;
+
+    return b;
+}
+
+void Buffer::stream(const void *v, size_t v_bytes) {
+    glBindBuffer(GL_ARRAY_BUFFER, id);
+
+    if (v_bytes > bytes) {
+        bytes = std::max(v_bytes, bytes * 2);
     }
+
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(v_bytes), v);
 }
 
 void draw_vertex_buffer(const ShaderPtr &shader, const VertexBufferPtr &v, const TexturePtr &optional_tex) {
+    draw_vertex_buffer(shader, v, optional_tex, v->index_count);
+}
+
+void draw_vertex_buffer(const ShaderPtr &shader,
+                        const VertexBufferPtr &v,
+                        const TexturePtr &optional_tex,
+                        size_t index_count) {
+    draw_vertex_buffer(shader, *v, optional_tex, index_count);
+}
+
+void draw_vertex_buffer(const ShaderPtr &shader,
+                        const VertexBuffer &v,
+                        const TexturePtr &optional_tex,
+                        size_t index_count,
+                        size_t first_index) {
     shader->use();
 
     if (optional_tex) {
         optional_tex->use();
-
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-
-        int stride = sizeof(float) * 4;
-        int uv_offset = sizeof(float) * 2;
-
-        v->use();
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, 0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(uv_offset));
-    } else {
-        glEnableVertexAttribArray(0);
-        v->use();
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
     }
 
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(v->index_count), GL_UNSIGNED_INT, 0);
+    size_t offset = first_index * (v.index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+
+    v.use();
+    glDrawElements(
+        GL_TRIANGLES, static_cast<GLsizei>(index_count), v.index_type, reinterpret_cast<const void *>(offset));
 }
 
 std::pair<glm::vec2, glm::vec2> bbox(const std::vector<glm::vec4> &vertex) {
@@ -2,62 +2,178 @@
 
 #define GL_GLEXT_PROTOTYPES
 #include <SDL3/SDL_opengles2.h>
+#include <SDL3/SDL_surface.h>
+
+// ES 3.0 core, not in the ES 2.0 headers
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// ES 3.0 core instancing, exported by libGLESv2 (and by Emscripten for WebGL 2) but not declared
+extern "C" {
+GL_APICALL void GL_APIENTRY glVertexAttribDivisor(GLuint index, GLuint divisor);
+GL_APICALL void GL_APIENTRY glDrawElementsInstanced(
+    GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount);
+}
 
+#include <array>
+#include <cstdint>
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
 // Light wrapper around common OpenGL types.
 // The unique_ptr will delete the OpenGL object automatically.
 
-struct VertexArray {
-    GLuint vao;
-    void use();
-};
-
-using VertexArrayPtr = std::unique_ptr<VertexArray, void (*)(VertexArray *)>;
-VertexArrayPtr make_vertex_array();
-
 struct Shader {
     GLuint program = 0;
     GLuint vertex = 0;
     GLuint fragment = 0;
 
+    // compile and link run in the driver after make_shader returns,
+    // the first use() or get_loc() waits for them
+    mutable bool pending = false;
+    mutable bool failed = false;
+    mutable std::string vertex_src;
+    mutable std::string fragment_src;
+    uint64_t cache_key = 0;
+    uint64_t submit_ns = 0;
+    mutable uint64_t build_ns = 0;  // GL thread time spent in compile and link calls, cached with the binary
+
     void use() const;                       // glUseProgram
     GLint get_loc(const char *name) const;  // glGetUniformLocation
+    bool wait() const;                      // false on compile or link error
 };
 
 using ShaderPtr = std::unique_ptr<Shader, void (*)(Shader *)>;
-ShaderPtr make_shader(const char *vertex_code, const char *fragment_code);
+// Each define is inserted as "#define NAME" after the #version line of both shaders.
+// Returns without waiting for the driver, errors are reported by Shader::wait.
+ShaderPtr make_shader(const char *vertex_code,
+                      const char *fragment_code,
+                      const std::vector<std::string> &defines = {});
 
 struct Texture {
     GLuint id = 0;
     int width = 0;
     int height = 0;
+    int levels = 1;
+    size_t bytes = 0;  // VRAM for all levels, as uploaded
 
     void use() const;
 };
 
 using TexturePtr = std::unique_ptr<Texture, void (*)(Texture *)>;
-TexturePtr make_texture(const std::string &bmp_path);
+using SurfacePtr = std::unique_ptr<SDL_Surface, void (*)(SDL_Surface *)>;
+// BMP file contents to an RGB24 or BGR24 surface. No GL calls, safe on any thread.
+SurfacePtr decode_bmp(std::span<const uint8_t> bmp, const std::string &name);
+// Uploads a surface from decode_bmp, name is for the log.
+TexturePtr make_texture(const SDL_Surface &rgb, const std::string &name);
+// BMP file contents, decode_bmp then upload.
+TexturePtr make_texture(std::span<const uint8_t> bmp, const std::string &name);
+// Uninitialized RGB8 texture with linear filtering, filled in pieces with update_texture.
+TexturePtr make_texture(int width, int height);
+// Uploads tightly packed RGB8 rows to the rect at (x, y), row 0 of the texture is v = 0.
+void update_texture(const Texture &tex, int x, int y, int width, int height, const uint8_t *rgb);
+// KTX 1.1 file contents with GL_COMPRESSED_RGB8_ETC2 levels, made by tools/atlas_compress.
+TexturePtr make_compressed_texture(std::span<const uint8_t> ktx, const std::string &name);
+
+// Offscreen render target with an RGBA color texture.
+struct Framebuffer {
+    GLuint fbo = 0;
+    TexturePtr color{{}, {}};
+
+    int width() const { return color->width; }
+    int height() const { return color->height; }
+};
+
+using FramebufferPtr = std::unique_ptr<Framebuffer, void (*)(Framebuffer *)>;
+FramebufferPtr make_framebuffer(int width, int height);
+
+// Plain array buffer, for data attached to other vertex arrays such as per instance attributes.
+struct Buffer {
+    GLuint id = 0;
+    size_t bytes = 0;  // allocated storage
+
+    // Orphans the storage and writes v, grows to at least v_bytes.
+    void stream(const void *v, size_t v_bytes);
+};
+
+using BufferPtr = std::unique_ptr<Buffer, void (*)(Buffer *)>;
+BufferPtr make_buffer(size_t bytes);
+
+// Describes how interleaved vertex data maps to shader attributes.
+// The attribute location is the index into attrib, size 0 means unused.
+struct VertexAttrib {
+    GLint size = 0;  // number of components
+    GLenum type = GL_FLOAT;
+    GLboolean normalized = GL_FALSE;
+    size_t offset = 0;  // bytes
+};
+
+struct VertexLayout {
+    std::array<VertexAttrib, 4> attrib{};
+    GLsizei stride = 0;  // bytes
+};
+
+constexpr VertexLayout LAYOUT_POS{{{{2, GL_FLOAT, GL_FALSE, 0}}}, sizeof(float) * 2};
+constexpr VertexLayout LAYOUT_POS_UV{{{{2, GL_FLOAT, GL_FALSE, 0}, {2, GL_FLOAT, GL_FALSE, sizeof(float) * 2}}},
+                                     sizeof(float) * 4};
+constexpr VertexLayout LAYOUT_POS_COLOR{{{{2, GL_FLOAT, GL_FALSE, 0}, {4, GL_FLOAT, GL_FALSE, sizeof(float) * 2}}},
+                                        sizeof(float) * 6};
+// Packed pos + texture uv + per letter attributes (see FontShader and LetterVertex)
+// pos: float, uv: normalized uint16, letter: float
+constexpr VertexLayout LAYOUT_POS_UV_LETTER{{{{2, GL_FLOAT, GL_FALSE, 0},
+                                              {2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(float) * 2},
+                                              {4, GL_FLOAT, GL_FALSE, sizeof(float) * 2 + sizeof(uint16_t) * 2}}},
+                                            sizeof(float) * 6 + sizeof(uint16_t) * 2};
+
+uint16_t pack_unorm16(float v);  // [0, 1]
 
 // This is general enough to represent all the drawing combos we need.
 // - vertex only
 // - vertex + texture uv
 // - vertex + color
+// The vertex array object captures the layout and both buffers when the buffer is created,
+// so drawing is a single bind.
+// Indices are stored as 16 bit when the vertex count allows it.
+// Quad buffers share one index buffer (0, 1, 2, 0, 2, 3, 4, 5, 6, ...) instead of owning one.
 struct VertexBuffer {
+    GLuint vao = 0;
     GLuint vertex = 0;
     GLuint index = 0;
 
+    VertexLayout layout;
     size_t vertex_bytes = 0;
     size_t index_count = 0;
+    size_t index_capacity = 0;
+    GLenum index_type = GL_UNSIGNED_INT;
+    bool shared_index = false;
 
-    void use() const;
+    size_t index_bytes() const;
+
+    void use() const;  // glBindVertexArray
     void update_vertex(const float *v,
                        size_t v_bytes,
                        const std::vector<uint32_t> &optional_index = {});  // pos + texture uv
+
+    // Orphans the vertex storage before writing so the driver doesn't wait for draws still using it.
+    // v_bytes must not exceed vertex_bytes.
+    void stream_vertex(const void *v, size_t v_bytes);
 };
 
 using VertexBufferPtr = std::unique_ptr<VertexBuffer, void (*)(VertexBuffer *)>;
@@ -65,10 +181,47 @@ using VertexBufferPtr = std::unique_ptr<VertexBuffer, void (*)(VertexBuffer *)>;
 VertexBufferPtr make_vertex_buffer(const std::vector<glm::vec2> &vertex, const std::vector<uint32_t> &index);
 VertexBufferPtr make_vertex_buffer(const std::vector<glm::vec4> &vertex,
                                    const std::vector<uint32_t> &index);  // pos + texture uv
-VertexBufferPtr make_vertex_buffer(const float *vertex, size_t vertex_bytes, const std::vector<uint32_t> &index);
+VertexBufferPtr make_vertex_buffer(const void *vertex,
+                                   size_t vertex_bytes,
+                                   const std::vector<uint32_t> &index,
+                                   const VertexLayout &layout);
+
+constexpr size_t MAX_QUADS = 65536 / 4;
+
+// 16 bit index buffer for quads (0, 1, 2, 0, 2, 3, 4, 5, 6, ...), one per GL context shared by every quad buffer.
+// It grows in place, so vertex arrays referencing it stay valid. Free it while its context is current.
+struct QuadIndex {
+    GLuint id = 0;
+    size_t quads = 0;  // capacity
+
+    // Binds it to the current VAO, grows it to at least quads first.
+    void bind(size_t quads);
+};
+
+using QuadIndexPtr = std::unique_ptr<QuadIndex, void (*)(QuadIndex *)>;
+QuadIndexPtr make_quad_index();
+
+// 4 vertices per quad, indexed by quad_index.
+VertexBufferPtr make_quad_vertex_buffer(QuadIndex &quad_index,
+                                        const void *vertex,
+                                        size_t vertex_bytes,
+                                        size_t quads,
+                                        const VertexLayout &layout);
 
 void draw_vertex_buffer(const ShaderPtr &shader, const VertexBufferPtr &v, const TexturePtr &optional_tex = {{}, {}});
 
+// Draws only the first index_count indices.
+void draw_vertex_buffer(const ShaderPtr &shader,
+                        const VertexBufferPtr &v,
+                        const TexturePtr &optional_tex,
+                        size_t index_count);
+// Draws index_count indices from first_index on.
+void draw_vertex_buffer(const ShaderPtr &shader,
+                        const VertexBuffer &v,
+                        const TexturePtr &optional_tex,
+                        size_t index_count,
+                        size_t first_index = 0);
+
 struct BBox {
     glm::vec2 start;
     glm::vec2 end;
@@ -93,3 +246,9 @@ BBox bbox(const std::vector<GLM_VEC> &vertex) {
 }
 
 void enable_gl_debug_callback();
+
+// Checks the GL_EXTENSIONS string for an exact match, e.g. "GL_EXT_disjoint_timer_query".
+bool has_gl_extension(const char *name);
+
+// Enables KHR_parallel_shader_compile when available. Call once after the context is created.
+void init_parallel_shader_compile();
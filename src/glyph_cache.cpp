@@ -0,0 +1,500 @@
+#include "glyph_cache.hpp"
+
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "log.hpp"
+#include "msdf.hpp"
+#include "trace.hpp"
+
+namespace {
+constexpr uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+int worker(void *data) {
+    GlyphCache &gc = *static_cast<GlyphCache *>(data);
+
+    TRACE_THREAD("glyphs");
+    SDL_LockMutex(gc.lock);
+
+    while (true) {
+        while (!gc.quit && gc.requests.empty()) {
+            SDL_WaitCondition(gc.wake, gc.lock);
+        }
+
+        if (gc.quit) {
+            break;
+        }
+
+        uint32_t codepoint = gc.requests.front();
+        gc.requests.pop_front();
+
+        SDL_UnlockMutex(gc.lock);
+
+        uint64_t start = SDL_GetTicksNS();
+        GlyphCache::Bitmap b = gc.render(codepoint);
+        uint64_t ns = SDL_GetTicksNS() - start;
+
+        SDL_LockMutex(gc.lock);
+        gc.done.push_back(std::move(b));
+        gc.generate_ns += ns;
+
+        if (gc.ready_event != 0 && gc.requests.empty()) {
+            SDL_Event event{};
+            event.type = gc.ready_event;
+            SDL_PushEvent(&event);
+        }
+    }
+
+    SDL_UnlockMutex(gc.lock);
+
+    return 0;
+}
+}  // namespace
+
+uint32_t next_utf8(const std::string &str, size_t &i) {
+    auto byte = [&](size_t at) { return static_cast<uint32_t>(static_cast<unsigned char>(str[at])); };
+
+    uint32_t c = byte(i++);
+
+    if (c < 0x80) {
+        return c;
+    }
+
+    int extra = c >= 0xF0 && c < 0xF8 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+    uint32_t min = extra == 3 ? 0x10000 : extra == 2 ? 0x800 : 0x80;
+
+    if (extra == 0 || i + static_cast<size_t>(extra) > str.size()) {
+        return REPLACEMENT_CHARACTER;
+    }
+
+    c &= 0x3Fu >> extra;
+
+    for (int k = 0; k < extra; k++) {
+        uint32_t b = byte(i + static_cast<size_t>(k));
+
+        if ((b & 0xC0) != 0x80) {
+            return REPLACEMENT_CHARACTER;
+        }
+
+        c = c << 6 | (b & 0x3F);
+    }
+
+    // overlong forms and surrogates
+    if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+        return REPLACEMENT_CHARACTER;
+    }
+
+    i += static_cast<size_t>(extra);
+    return c;
+}
+
+void SkylinePacker::reset(int w, int h) {
+    width = w;
+    height = h;
+    skyline.assign(1, Segment{0, 0, w});
+}
+
+bool SkylinePacker::pack(int w, int h, int &x, int &y) {
+    size_t best = skyline.size();
+    int best_x = 0;
+    int best_y = 0;
+
+    for (size_t i = 0; i < skyline.size(); i++) {
+        int left = skyline[i].x;
+
+        if (left + w > width) {
+            break;
+        }
+
+        // the rect rests on the highest segment under it, scanning left to right keeps the leftmost on a tie
+        int top = 0;
+        int covered = 0;
+
+        for (size_t j = i; j < skyline.size() && covered < w; j++) {
+            top = std::max(top, skyline[j].y);
+            covered = skyline[j].x + skyline[j].width - left;
+        }
+
+        if (top + h > height) {
+            continue;
+        }
+
+        if (best == skyline.size() || top < best_y) {
+            best = i;
+            best_x = left;
+            best_y = top;
+        }
+    }
+
+    if (best == skyline.size()) {
+        return false;
+    }
+
+    x = best_x;
+    y = best_y;
+
+    // the rect's top replaces the segments it covers, the last one may be cut
+    int right = best_x + w;
+    size_t i = best;
+
+    while (i < skyline.size() && skyline[i].x < right) {
+        Segment &s = skyline[i];
+        int end = s.x + s.width;
+
+        if (end <= right) {
+            skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            s.width = end - right;
+            s.x = right;
+            break;
+        }
+    }
+
+    skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(best), Segment{best_x, best_y + h, w});
+
+    // merge neighbours at the same height
+    for (size_t k = 0; k + 1 < skyline.size();) {
+        if (skyline[k].y == skyline[k + 1].y) {
+            skyline[k].width += skyline[k + 1].width;
+            skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(k + 1));
+        } else {
+            k++;
+        }
+    }
+
+    return true;
+}
+
+bool GlyphCache::init(Vfs &vfs, const std::string &ttf_name, float em, int range) {
+    AssetData ttf = vfs.read(ttf_name);
+
+    if (!ttf) {
+        LOG("Failed to open file '%s'.", ttf_name.c_str());
+        return false;
+    }
+
+    if (!font.load(ttf.bytes.data(), ttf.bytes.size())) {
+        LOG("%s: not a TrueType font with glyf outlines", ttf_name.c_str());
+        return false;
+    }
+
+    em_size = em;
+    distance_range = range;
+
+    lock = SDL_CreateMutex();
+    wake = SDL_CreateCondition();
+    quit = false;
+
+    if (lock && wake) {
+        thread = SDL_CreateThread(worker, "glyphs", this);
+    }
+
+    if (!thread) {
+        LOG("can't create glyph thread: %s", SDL_GetError());
+        shutdown();
+        return false;
+    }
+
+    LOG("glyph cache: %s, %d glyphs, %d pages of %dx%d",
+        ttf_name.c_str(),
+        static_cast<int>(font.num_glyphs),
+        static_cast<int>(max_pages),
+        PAGE_SIZE,
+        PAGE_SIZE);
+
+    return true;
+}
+
+void GlyphCache::shutdown() {
+    if (thread) {
+        SDL_LockMutex(lock);
+        quit = true;
+        SDL_SignalCondition(wake);
+        SDL_UnlockMutex(lock);
+
+        SDL_WaitThread(thread, nullptr);
+        thread = nullptr;
+    }
+
+    if (wake) {
+        SDL_DestroyCondition(wake);
+        wake = nullptr;
+    }
+
+    if (lock) {
+        SDL_DestroyMutex(lock);
+        lock = nullptr;
+    }
+}
+
+GlyphCache::Bitmap GlyphCache::render(uint32_t codepoint) const {
+    TRACE_ZONE("glyph msdf");
+
+    Bitmap b;
+    b.codepoint = codepoint;
+
+    GlyphOutline outline;
+    uint32_t glyph = font.glyph_index(codepoint);
+
+    if (!font.outline(glyph, outline)) {
+        LOG("glyph %u for U+%04X is malformed", glyph, codepoint);
+    }
+
+    float scale = em_size / static_cast<float>(font.units_per_em);
+    b.quad.advance = outline.advance * scale;
+
+    if (outline.contours.empty()) {
+        return b;
+    }
+
+    // room for the distance range outside the outline plus a texel for filtering
+    float pad = std::ceil(static_cast<float>(distance_range) * 0.5f) + 1.f;
+    float left = std::floor(outline.min.x * scale) - pad;
+    float bottom = std::floor(outline.min.y * scale) - pad;
+    float right = std::ceil(outline.max.x * scale) + pad;
+    float top = std::ceil(outline.max.y * scale) + pad;
+
+    b.width = static_cast<int>(right - left);
+    b.height = static_cast<int>(top - bottom);
+
+    if (b.width + GUTTER > PAGE_SIZE || b.height + GUTTER > PAGE_SIZE) {
+        LOG("glyph for U+%04X is %dx%d, too big for a page", codepoint, b.width, b.height);
+        b.width = 0;
+        b.height = 0;
+        return b;
+    }
+
+    b.rgb.resize(static_cast<size_t>(b.width) * static_cast<size_t>(b.height) * 3);
+    generate_msdf(outline,
+                  scale,
+                  glm::vec2{-left / scale, -bottom / scale},
+                  static_cast<float>(distance_range),
+                  b.width,
+                  b.height,
+                  b.rgb.data());
+
+    // y down from the baseline, (x0, y0) is the bottom left corner like GlyphTable's quads
+    b.quad.pos = glm::vec4{left, -bottom, right, -top};
+
+    return b;
+}
+
+const GlyphCache::Entry *GlyphCache::get(uint32_t codepoint) {
+    auto it = entries.find(codepoint);
+
+    if (it == entries.end()) {
+        misses++;
+        entries.emplace(codepoint, Entry{});
+
+        SDL_LockMutex(lock);
+        requests.push_back(codepoint);
+        SDL_SignalCondition(wake);
+        SDL_UnlockMutex(lock);
+
+        return nullptr;
+    }
+
+    const Entry &e = it->second;
+
+    if (!e.ready) {
+        return nullptr;
+    }
+
+    hits++;
+
+    if (e.page >= 0) {
+        pages[static_cast<size_t>(e.page)].last_used = frame;
+    }
+
+    return &e;
+}
+
+void GlyphCache::update() {
+    if (!thread) {
+        return;
+    }
+
+    TRACE_ZONE("glyph cache update");
+
+    std::vector<Bitmap> arrived;
+
+    SDL_LockMutex(lock);
+    arrived.swap(done);
+    SDL_UnlockMutex(lock);
+
+    generated += arrived.size();
+
+    // deferred ones first, they've waited longest
+    std::vector<Bitmap> pending;
+    pending.swap(deferred);
+    pending.insert(pending.end(),
+                   std::make_move_iterator(arrived.begin()),
+                   std::make_move_iterator(arrived.end()));
+
+    for (Bitmap &b : pending) {
+        if (!place(b)) {
+            deferred.push_back(std::move(b));
+        }
+    }
+
+    frame++;
+}
+
+bool GlyphCache::place(Bitmap &b) {
+    auto it = entries.find(b.codepoint);
+
+    // evicted while the worker had it, a later miss asks again
+    if (it == entries.end()) {
+        return true;
+    }
+
+    Entry &e = it->second;
+
+    if (b.width == 0) {
+        e.quad = b.quad;
+        e.page = -1;
+        e.ready = true;
+        return true;
+    }
+
+    int x = 0;
+    int y = 0;
+    int page = -1;
+
+    for (size_t i = 0; i < pages.size() && page < 0; i++) {
+        if (pages[i].packer.pack(b.width + GUTTER, b.height + GUTTER, x, y)) {
+            page = static_cast<int>(i);
+        }
+    }
+
+    if (page < 0 && pages.size() < max_pages) {
+        Page p;
+        p.tex = make_texture(PAGE_SIZE, PAGE_SIZE);
+        p.packer.reset(PAGE_SIZE, PAGE_SIZE);
+        pages.push_back(std::move(p));
+
+        page = static_cast<int>(pages.size() - 1);
+        pages.back().packer.pack(b.width + GUTTER, b.height + GUTTER, x, y);
+    }
+
+    if (page < 0) {
+        page = evict();
+
+        if (page < 0) {
+            return false;
+        }
+
+        pages[static_cast<size_t>(page)].packer.pack(b.width + GUTTER, b.height + GUTTER, x, y);
+    }
+
+    Page &p = pages[static_cast<size_t>(page)];
+    update_texture(*p.tex, x, y, b.width, b.height, b.rgb.data());
+
+    uploads++;
+    upload_bytes += b.rgb.size();
+
+    // rows go top down, so the bottom edge is the last row
+    float size = static_cast<float>(PAGE_SIZE);
+    b.quad.uv = glm::vec4{static_cast<float>(x) / size,
+                          static_cast<float>(y + b.height) / size,
+                          static_cast<float>(x + b.width) / size,
+                          static_cast<float>(y) / size};
+
+    e.quad = b.quad;
+    e.page = page;
+    e.ready = true;
+    p.glyphs.push_back(b.codepoint);
+
+    return true;
+}
+
+int GlyphCache::evict() {
+    int victim = -1;
+
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (pages[i].last_used == frame) {
+            continue;
+        }
+
+        if (victim < 0 || pages[i].last_used < pages[static_cast<size_t>(victim)].last_used) {
+            victim = static_cast<int>(i);
+        }
+    }
+
+    if (victim < 0) {
+        return -1;
+    }
+
+    Page &p = pages[static_cast<size_t>(victim)];
+
+    for (uint32_t codepoint : p.glyphs) {
+        entries.erase(codepoint);
+    }
+
+    // the old texels stay until overwritten, nothing samples them anymore
+    p.glyphs.clear();
+    p.packer.reset(PAGE_SIZE, PAGE_SIZE);
+
+    evictions++;
+    generation++;
+
+    return victim;
+}
+
+bool GlyphCache::layout(const std::string &str,
+                        const GlyphTable &atlas,
+                        float scale,
+                        std::vector<glm::vec4> &atlas_vertex_uv,
+                        std::vector<std::vector<glm::vec4>> &page_vertex_uv) {
+    if (page_vertex_uv.size() < max_pages) {
+        page_vertex_uv.resize(max_pages);
+    }
+
+    float units = em_size / static_cast<float>(font.units_per_em);
+    float pen = 0;
+    bool complete = true;
+
+    // same corner order as layout_quads
+    auto add_quad = [&](std::vector<glm::vec4> &v, const GlyphQuad &q) {
+        float x0 = (q.pos.x + pen) * scale;
+        float y0 = q.pos.y * scale;
+        float x1 = (q.pos.z + pen) * scale;
+        float y1 = q.pos.w * scale;
+
+        v.push_back(glm::vec4{x0, y0, q.uv.x, q.uv.y});
+        v.push_back(glm::vec4{x1, y0, q.uv.z, q.uv.y});
+        v.push_back(glm::vec4{x1, y1, q.uv.z, q.uv.w});
+        v.push_back(glm::vec4{x0, y1, q.uv.x, q.uv.w});
+    };
+
+    for (size_t i = 0; i < str.size();) {
+        uint32_t codepoint = next_utf8(str, i);
+        int unicode = static_cast<int>(codepoint);
+
+        if (atlas.contains(unicode)) {
+            const GlyphQuad &q = atlas.get(unicode);
+            add_quad(atlas_vertex_uv, q);
+            pen += q.advance;
+            continue;
+        }
+
+        const Entry *e = get(codepoint);
+
+        if (!e) {
+            pen += font.advance(font.glyph_index(codepoint)) * units;
+            complete = false;
+            continue;
+        }
+
+        if (e->page >= 0) {
+            add_quad(page_vertex_uv[static_cast<size_t>(e->page)], e->quad);
+        }
+
+        pen += e->quad.advance;
+    }
+
+    return complete;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_thread.h>
+
+#include <cstdint>
+#include <deque>
+#include <glm/vec4.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gl_helper.hpp"
+#include "glyph_table.hpp"
+#include "truetype.hpp"
+#include "vfs.hpp"
+
+// Skyline rectangle packer with the bottom-left rule: a rect goes where its far edge ends up
+// nearest to the origin, leftmost on a tie. Texel units, y grows away from the origin row.
+struct SkylinePacker {
+    struct Segment {
+        int x;
+        int y;
+        int width;
+    };
+
+    int width = 0;
+    int height = 0;
+    std::vector<Segment> skyline;
+
+    void reset(int w, int h);
+    // False when the rect doesn't fit anywhere.
+    bool pack(int w, int h, int &x, int &y);
+};
+
+// Next code point of UTF-8 str at i, advances i. Malformed sequences decode to U+FFFD one byte at a time.
+uint32_t next_utf8(const std::string &str, size_t &i);
+
+// Glyph atlas filled at run time from a TrueType font, for characters the prebuilt atlas lacks.
+// A miss queues the code point for a worker thread that generates its MSDF, update() packs the results
+// into PAGE_SIZE pages and uploads them with glTexSubImage2D. Glyphs are generated at the prebuilt
+// atlas' em size and distance range so FontShader draws them with the same uniforms, binding the
+// page texture instead of FontAtlas::tex.
+//
+// When all pages are full the least recently used one is cleared, its glyphs are generated again on
+// their next use. A page used since the last update() is never cleared, the upload waits instead.
+// Laid out vertices refer to page texels, lay out again when generation changes.
+//
+// Everything but the worker runs on the GL thread. The worker pushes ready_event, when set, once it
+// has no more requests, so an idle app draws a frame that picks up the new glyphs.
+struct GlyphCache {
+    static constexpr int PAGE_SIZE = 512;
+    static constexpr int GUTTER = 1;  // texels between glyphs so linear filtering doesn't bleed
+
+    struct Page {
+        TexturePtr tex{{}, {}};
+        SkylinePacker packer;
+        uint64_t last_used = 0;        // frame
+        std::vector<uint32_t> glyphs;  // code points, to forget them on eviction
+    };
+
+    // MSDF from the worker, waiting to be packed
+    struct Bitmap {
+        uint32_t codepoint = 0;
+        GlyphQuad quad;  // uv is set when packed
+        int width = 0;   // 0 for glyphs without contours
+        int height = 0;
+        std::vector<uint8_t> rgb;
+    };
+
+    struct Entry {
+        GlyphQuad quad;
+        int page = -1;  // -1 without a bitmap, e.g. space
+        bool ready = false;
+    };
+
+    TrueTypeFont font;  // read only once the worker runs
+    float em_size = 0;  // pixels per em
+    int distance_range = 0;
+    size_t max_pages = 4;
+    Uint32 ready_event = 0;  // set before init
+
+    std::vector<Page> pages;
+    std::unordered_map<uint32_t, Entry> entries;  // pending ones too, so a miss is queued once
+    std::vector<Bitmap> deferred;                 // didn't fit without evicting a page in use
+    uint64_t frame = 1;
+    uint64_t generation = 0;  // bumped on eviction
+
+    // worker, requests and done are guarded by lock
+    SDL_Thread *thread = nullptr;
+    SDL_Mutex *lock = nullptr;
+    SDL_Condition *wake = nullptr;
+    std::deque<uint32_t> requests;
+    std::vector<Bitmap> done;
+    bool quit = false;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t generated = 0;
+    uint64_t generate_ns = 0;  // worker time, guarded by lock
+    uint64_t uploads = 0;
+    uint64_t upload_bytes = 0;
+    uint64_t evictions = 0;
+
+    GlyphCache() = default;
+    GlyphCache(const GlyphCache &) = delete;
+    GlyphCache &operator=(const GlyphCache &) = delete;
+    ~GlyphCache() { shutdown(); }
+
+    // em_size and distance_range come from the FontAtlas the glyphs are drawn next to.
+    bool init(Vfs &vfs, const std::string &ttf_name, float em, int range);
+    void shutdown();
+    bool ready() const { return thread != nullptr; }
+
+    // Packs and uploads what the worker finished, call once per frame before laying out.
+    void update();
+
+    // nullptr while the glyph is being generated, a miss queues it.
+    const Entry *get(uint32_t codepoint);
+
+    // Like FontAtlas::layout_text for UTF-8 str. Code points the atlas has go to atlas_vertex_uv, the others
+    // come from the cache split by page: page_vertex_uv[i] gets the glyphs on page i. 4 pos + uv vertices
+    // per glyph, appended. Glyphs still being generated take up their advance but get no quad, returns
+    // false if there were any.
+    bool layout(const std::string &str,
+                const GlyphTable &atlas,
+                float scale,
+                std::vector<glm::vec4> &atlas_vertex_uv,
+                std::vector<std::vector<glm::vec4>> &page_vertex_uv);
+
+    Bitmap render(uint32_t codepoint) const;
+
+private:
+    bool place(Bitmap &b);
+    int evict();
+};
@@ -0,0 +1,224 @@
+#include "glyph_table.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// define GLYPH_NO_SIMD to compare against the scalar path
+#if defined(GLYPH_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GLYPH_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GLYPH_NEON
+#endif
+
+namespace {
+// glyphs per layout_quads call from layout_glyphs, keeps the index scratch on the stack
+constexpr size_t CHUNK = 64;
+
+GlyphQuad make_quad(const Glyph &g, float em_size, float tex_width, float tex_height) {
+    float x = g.plane_left * em_size;
+    float y = std::abs(g.plane_bottom) * em_size;
+
+    GlyphQuad q;
+    q.pos = glm::vec4{x, y, x + g.atlas_right - g.atlas_left, y - (g.atlas_top - g.atlas_bottom)};
+    q.uv = glm::vec4{g.atlas_left / tex_width,
+                     1 - g.atlas_bottom / tex_height,
+                     g.atlas_right / tex_width,
+                     1 - g.atlas_top / tex_height};
+    q.advance = g.advance * em_size;
+    return q;
+}
+
+bool less_code_point(const std::pair<int, uint32_t> &a, int unicode) { return a.first < unicode; }
+}  // namespace
+
+void GlyphTable::build(const std::vector<std::pair<int, Glyph>> &glyphs,
+                       float em_size,
+                       int tex_width,
+                       int tex_height) {
+    float w = static_cast<float>(tex_width);
+    float h = static_cast<float>(tex_height);
+
+    quad.assign(1, GlyphQuad{});
+    quad[0].advance = 0.5f * em_size;
+
+    direct.fill(0);
+    sorted.clear();
+
+    for (const auto &[unicode, g] : glyphs) {
+        uint32_t i = static_cast<uint32_t>(quad.size());
+        quad.push_back(make_quad(g, em_size, w, h));
+
+        if (unicode >= 0 && unicode < DIRECT_SIZE) {
+            direct[static_cast<size_t>(unicode)] = i;
+        } else {
+            sorted.emplace_back(unicode, i);
+        }
+    }
+
+    // stable so the last of a repeated code point ends up last, then keep only that one
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    auto last = std::unique(sorted.rbegin(), sorted.rend(), [](const auto &a, const auto &b) {
+        return a.first == b.first;
+    });
+    sorted.erase(sorted.begin(), last.base());
+
+    if (direct['?'] != 0) {
+        quad[0] = quad[direct['?']];
+    }
+}
+
+uint32_t GlyphTable::index_sorted(int unicode) const {
+    auto it = std::lower_bound(sorted.begin(), sorted.end(), unicode, less_code_point);
+
+    if (it != sorted.end() && it->first == unicode) {
+        return it->second;
+    }
+
+    return 0;
+}
+
+void GlyphTable::lookup(const std::string &str, std::vector<uint32_t> &glyph) const {
+    for (char ch : str) {
+        glyph.push_back(index(static_cast<unsigned char>(ch)));
+    }
+}
+
+GlyphBounds layout_quads(
+    const GlyphTable &table, const uint32_t *glyph, size_t count, float scale, float &pen, glm::vec4 *out) {
+    if (count == 0) {
+        return {};
+    }
+
+    const GlyphQuad *quad = table.quad.data();
+
+#if defined(GLYPH_SSE2)
+    __m128 s = _mm_set1_ps(scale);
+    __m128 lo = _mm_set1_ps(INFINITY);
+    __m128 hi = _mm_set1_ps(-INFINITY);
+
+    // lanes 0 and 2 take the second vertex's value when building the mixed corners
+    __m128 x_lanes = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+
+    for (size_t i = 0; i < count; i++) {
+        const GlyphQuad &q = quad[glyph[i]];
+
+        // x0, y0, x1, y1 at the pen, scaled
+        __m128 p = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&q.pos.x), _mm_set_ps(0.f, pen, 0.f, pen)), s);
+        __m128 uv = _mm_loadu_ps(&q.uv.x);
+
+        lo = _mm_min_ps(lo, p);
+        hi = _mm_max_ps(hi, p);
+
+        __m128 v0 = _mm_movelh_ps(p, uv);  // x0, y0, u0, v0
+        __m128 v2 = _mm_movehl_ps(uv, p);  // x1, y1, u1, v1
+        __m128 v1 = _mm_or_ps(_mm_and_ps(x_lanes, v2), _mm_andnot_ps(x_lanes, v0));
+        __m128 v3 = _mm_or_ps(_mm_and_ps(x_lanes, v0), _mm_andnot_ps(x_lanes, v2));
+
+        float *o = &out[i * 4].x;
+        _mm_storeu_ps(o, v0);
+        _mm_storeu_ps(o + 4, v1);
+        _mm_storeu_ps(o + 8, v2);
+        _mm_storeu_ps(o + 12, v3);
+
+        pen += q.advance;
+    }
+
+    float l[4];
+    float h[4];
+    _mm_storeu_ps(l, lo);
+    _mm_storeu_ps(h, hi);
+#elif defined(GLYPH_NEON)
+    float32x4_t lo = vdupq_n_f32(INFINITY);
+    float32x4_t hi = vdupq_n_f32(-INFINITY);
+
+    const uint32_t mask[4] = {~0u, 0u, ~0u, 0u};
+    uint32x4_t x_lanes = vld1q_u32(mask);
+
+    for (size_t i = 0; i < count; i++) {
+        const GlyphQuad &q = quad[glyph[i]];
+
+        float32x2_t offset = vset_lane_f32(pen, vdup_n_f32(0.f), 0);
+        float32x4_t p = vmulq_n_f32(vaddq_f32(vld1q_f32(&q.pos.x), vcombine_f32(offset, offset)), scale);
+        float32x4_t uv = vld1q_f32(&q.uv.x);
+
+        lo = vminq_f32(lo, p);
+        hi = vmaxq_f32(hi, p);
+
+        float32x4_t v0 = vcombine_f32(vget_low_f32(p), vget_low_f32(uv));
+        float32x4_t v2 = vcombine_f32(vget_high_f32(p), vget_high_f32(uv));
+
+        float *o = &out[i * 4].x;
+        vst1q_f32(o, v0);
+        vst1q_f32(o + 4, vbslq_f32(x_lanes, v2, v0));
+        vst1q_f32(o + 8, v2);
+        vst1q_f32(o + 12, vbslq_f32(x_lanes, v0, v2));
+
+        pen += q.advance;
+    }
+
+    float l[4];
+    float h[4];
+    vst1q_f32(l, lo);
+    vst1q_f32(h, hi);
+#else
+    float l[4] = {INFINITY, INFINITY, INFINITY, INFINITY};
+    float h[4] = {-INFINITY, -INFINITY, -INFINITY, -INFINITY};
+
+    for (size_t i = 0; i < count; i++) {
+        const GlyphQuad &q = quad[glyph[i]];
+
+        float p[4] = {(q.pos.x + pen) * scale, q.pos.y * scale, (q.pos.z + pen) * scale, q.pos.w * scale};
+
+        for (size_t c = 0; c < 4; c++) {
+            l[c] = std::min(l[c], p[c]);
+            h[c] = std::max(h[c], p[c]);
+        }
+
+        glm::vec4 *o = &out[i * 4];
+        o[0] = glm::vec4{p[0], p[1], q.uv.x, q.uv.y};
+        o[1] = glm::vec4{p[2], p[1], q.uv.z, q.uv.y};
+        o[2] = glm::vec4{p[2], p[3], q.uv.z, q.uv.w};
+        o[3] = glm::vec4{p[0], p[3], q.uv.x, q.uv.w};
+
+        pen += q.advance;
+    }
+#endif
+
+    // x is in lanes 0 and 2, y in lanes 1 and 3
+    return GlyphBounds{glm::vec2{std::min(l[0], l[2]), std::min(l[1], l[3])},
+                       glm::vec2{std::max(h[0], h[2]), std::max(h[1], h[3])}};
+}
+
+GlyphBounds layout_glyphs(const GlyphTable &table,
+                          const std::string &str,
+                          float scale,
+                          std::vector<glm::vec4> &vertex_uv) {
+    if (str.empty()) {
+        return {};
+    }
+
+    size_t first = vertex_uv.size();
+    vertex_uv.resize(first + str.size() * 4);
+
+    GlyphBounds bounds{glm::vec2{INFINITY}, glm::vec2{-INFINITY}};
+    float pen = 0.f;
+    uint32_t glyph[CHUNK];
+
+    for (size_t start = 0; start < str.size(); start += CHUNK) {
+        size_t n = std::min(CHUNK, str.size() - start);
+
+        for (size_t i = 0; i < n; i++) {
+            glyph[i] = table.index(static_cast<unsigned char>(str[start + i]));
+        }
+
+        GlyphBounds b = layout_quads(table, glyph, n, scale, pen, &vertex_uv[first + start * 4]);
+
+        bounds.start = glm::vec2{std::min(bounds.start.x, b.start.x), std::min(bounds.start.y, b.start.y)};
+        bounds.end = glm::vec2{std::max(bounds.end.x, b.end.x), std::max(bounds.end.y, b.end.y)};
+    }
+
+    return bounds;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+// How to render the Glyph
+// Plane is offset relative to cursor pos
+// Atlas is bounding box in the texture atlas
+struct Glyph {
+    float advance;     // em, x increment
+    float plane_left;  // em
+    float plane_bottom;
+    float plane_right;
+    float plane_top;
+    float atlas_left;  // pixel
+    float atlas_bottom;
+    float atlas_right;
+    float atlas_top;
+};
+
+// Layout ready form of a Glyph, computed once at load. Atlas pixel units.
+// The quad corner (x0, y0) samples (u0, v0) and the opposite corner (x1, y1) samples (u1, v1).
+struct GlyphQuad {
+    glm::vec4 pos{};  // x0, y0, x1, y1 relative to the pen position
+    glm::vec4 uv{};   // u0, v0, u1, v1
+    float advance = 0.f;
+};
+
+// Glyph lookup without tree walks. Glyphs live in one flat array and are referred to by index.
+// ASCII and Latin-1 index a table directly, other code points binary search a sorted vector.
+// Missing characters map to index 0, an explicit fallback glyph ('?' when the atlas has one,
+// otherwise an empty quad half an em wide) instead of a zeroed entry.
+struct GlyphTable {
+    static constexpr int DIRECT_SIZE = 256;
+
+    std::vector<GlyphQuad> quad;                    // [0] is the fallback
+    std::array<uint32_t, DIRECT_SIZE> direct{};     // index into quad
+    std::vector<std::pair<int, uint32_t>> sorted;  // code points from DIRECT_SIZE up
+
+    // glyphs in any order, a repeated code point keeps the last one
+    void build(const std::vector<std::pair<int, Glyph>> &glyphs, float em_size, int tex_width, int tex_height);
+
+    uint32_t index(int unicode) const {
+        if (unicode >= 0 && unicode < DIRECT_SIZE) {
+            return direct[static_cast<size_t>(unicode)];
+        }
+
+        return index_sorted(unicode);
+    }
+
+    uint32_t index_sorted(int unicode) const;
+    const GlyphQuad &get(int unicode) const { return quad[index(unicode)]; }
+    bool contains(int unicode) const { return index(unicode) != 0; }
+    size_t size() const { return quad.empty() ? 0 : quad.size() - 1; }
+
+    // Appends one index per byte of str, bytes are Latin-1.
+    void lookup(const std::string &str, std::vector<uint32_t> &glyph) const;
+};
+
+struct GlyphBounds {
+    glm::vec2 start{};
+    glm::vec2 end{};
+};
+
+// Positions count glyphs one after another starting at pen and writes 4 pos + uv vertices per glyph
+// to out, which must have room for count * 4. Positions are atlas pixels times scale, pen is in atlas
+// pixels and is left after the last glyph, so a long run can be laid out in pieces.
+// Returns the bounding box of the written positions, computed in the same pass.
+// SSE2 or NEON when the target has them, scalar otherwise.
+GlyphBounds layout_quads(
+    const GlyphTable &table, const uint32_t *glyph, size_t count, float scale, float &pen, glm::vec4 *out);
+
+// Appends 4 pos + uv vertices per byte of str through layout_quads, no allocation if vertex_uv has capacity.
+GlyphBounds layout_glyphs(const GlyphTable &table,
+                          const std::string &str,
+                          float scale,
+                          std::vector<glm::vec4> &vertex_uv);
@@ -0,0 +1,318 @@
+#include "headless.hpp"
+
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "bench_scene.hpp"
+#include "log.hpp"
+
+namespace {
+// Letters change every half second in the highlight scene.
+constexpr int FRAMES_PER_LETTER = 30;
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+bool write_ppm(const std::string &path, const Image &img) {
+    std::string header = "P6\n" + std::to_string(img.width) + " " + std::to_string(img.height) + "\n255\n";
+
+    std::vector<uint8_t> data(header.begin(), header.end());
+    data.insert(data.end(), img.rgb.begin(), img.rgb.end());
+
+    if (!SDL_SaveFile(path.c_str(), data.data(), data.size())) {
+        LOG("can't write %s", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool read_ppm(const std::string &path, Image &img) {
+    size_t size = 0;
+    char *data = static_cast<char *>(SDL_LoadFile(path.c_str(), &size));
+
+    if (!data) {
+        LOG("can't read %s", path.c_str());
+        return false;
+    }
+
+    int maxval = 0;
+    int offset = 0;
+    bool ok = sscanf(data, "P6 %d %d %d%n", &img.width, &img.height, &maxval, &offset) == 3 && maxval == 255;
+
+    // a single whitespace separates the header from the pixels
+    size_t start = static_cast<size_t>(offset) + 1;
+    size_t bytes = static_cast<size_t>(img.width) * static_cast<size_t>(img.height) * 3;
+
+    if (ok && start + bytes <= size) {
+        img.rgb.assign(data + start, data + start + bytes);
+    } else {
+        LOG("bad PPM file %s", path.c_str());
+        ok = false;
+    }
+
+    SDL_free(data);
+
+    return ok;
+}
+
+Image read_framebuffer(const Framebuffer &fb) {
+    Image img;
+    img.width = fb.width();
+    img.height = fb.height();
+
+    size_t w = static_cast<size_t>(img.width);
+    size_t h = static_cast<size_t>(img.height);
+
+    std::vector<uint8_t> rgba(w * h * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, img.width, img.height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    // GL rows start at the bottom
+    img.rgb.resize(w * h * 3);
+    for (size_t y = 0; y < h; y++) {
+        const uint8_t *src = &rgba[(h - 1 - y) * w * 4];
+        uint8_t *dst = &img.rgb[y * w * 3];
+
+        for (size_t x = 0; x < w; x++) {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+    return img;
+}
+
+// counts are positive, the tolerance can be 0
+bool parse_int(const char *str, int &out, long min = 1) {
+    char *end = nullptr;
+    long v = strtol(str, &end, 10);
+
+    if (!end || *end != '\0' || v < min) {
+        return false;
+    }
+
+    out = static_cast<int>(v);
+    return true;
+}
+}  // namespace
+
+bool parse_headless_args(int argc, char *argv[], HeadlessOptions &opt) {
+    std::vector<std::string> unknown;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        auto need_value = [&]() {
+            if (!value) {
+                LOG("missing value for %s", arg.c_str());
+                return false;
+            }
+            i++;
+            return true;
+        };
+
+        if (arg == "--headless") {
+            opt.enabled = true;
+        } else if (arg == "--update-golden") {
+            opt.update_golden = true;
+        } else if (arg == "--frames") {
+            if (!need_value() || !parse_int(value, opt.frames)) {
+                return false;
+            }
+        } else if (arg == "--dump-every") {
+            if (!need_value() || !parse_int(value, opt.dump_every)) {
+                return false;
+            }
+        } else if (arg == "--tolerance") {
+            if (!need_value() || !parse_int(value, opt.tolerance, 0)) {
+                return false;
+            }
+        } else if (arg == "--size") {
+            if (!need_value() || sscanf(value, "%dx%d", &opt.width, &opt.height) != 2 || opt.width <= 0 ||
+                opt.height <= 0) {
+                LOG("bad --size, expected WxH");
+                return false;
+            }
+        } else if (arg == "--scene") {
+            if (!need_value()) {
+                return false;
+            }
+            opt.scene = value;
+
+            bool scripted = opt.scene == "grid" || opt.scene == "highlight" || opt.scene == "hud";
+
+            if (!scripted && !BenchScene::known(opt.scene)) {
+                LOG("unknown scene %s", value);
+                return false;
+            }
+        } else if (arg == "--out") {
+            if (!need_value()) {
+                return false;
+            }
+            opt.out_dir = std::string(value) + "/";
+        } else if (arg == "--golden") {
+            if (!need_value()) {
+                return false;
+            }
+            opt.golden_dir = std::string(value) + "/";
+        } else {
+            unknown.push_back(arg);
+        }
+    }
+
+    // launchers and IDEs add their own arguments, only a scripted run has to be exact
+    for (const std::string &arg : unknown) {
+        LOG("%s argument %s", opt.enabled ? "unknown" : "ignoring", arg.c_str());
+    }
+
+    return !opt.enabled || unknown.empty();
+}
+
+bool Headless::init(const HeadlessOptions &options) {
+    opt = options;
+
+    fb = make_framebuffer(opt.width, opt.height);
+
+    if (!fb) {
+        LOG("can't create headless framebuffer %dx%d", opt.width, opt.height);
+        return false;
+    }
+
+    frame_ns.reserve(static_cast<size_t>(opt.frames));
+
+    LOG("headless: %s, %d frames at %dx%d, renderer: %s",
+        opt.scene.c_str(),
+        opt.frames,
+        opt.width,
+        opt.height,
+        reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+    return true;
+}
+
+char Headless::scripted_letter() const {
+    if (opt.scene != "highlight") {
+        return 0;
+    }
+
+    return static_cast<char>('A' + (frame / FRAMES_PER_LETTER) % 26);
+}
+
+void Headless::begin_frame() { glBindFramebuffer(GL_FRAMEBUFFER, fb->fbo); }
+
+bool Headless::end_frame(uint64_t start_ns) {
+    // llvmpipe renders asynchronously too, wait so the timing covers the whole frame
+    glFinish();
+    frame_ns.push_back(SDL_GetTicksNS() - start_ns);
+
+    bool ok = true;
+    bool dump = (frame % opt.dump_every) == 0 || frame == opt.frames - 1;
+
+    if (dump && (!opt.out_dir.empty() || !opt.golden_dir.empty())) {
+        Image img = read_framebuffer(*fb);
+        std::string name = opt.scene + "_" + std::to_string(frame) + ".ppm";
+
+        if (!opt.out_dir.empty()) {
+            write_ppm(opt.out_dir + name, img);
+        }
+
+        if (opt.update_golden && !opt.golden_dir.empty()) {
+            write_ppm(opt.golden_dir + name, img);
+        } else if (!opt.golden_dir.empty()) {
+            Image golden;
+            golden_checked++;
+
+            if (!read_ppm(opt.golden_dir + name, golden) || golden.width != img.width ||
+                golden.height != img.height) {
+                LOG("golden %s: missing or size mismatch", name.c_str());
+                ok = false;
+            } else {
+                size_t bad = 0;
+                int max_diff = 0;
+
+                for (size_t i = 0; i < img.rgb.size(); i += 3) {
+                    int d = 0;
+                    for (size_t c = 0; c < 3; c++) {
+                        d = std::max(d, std::abs(img.rgb[i + c] - golden.rgb[i + c]));
+                    }
+
+                    max_diff = std::max(max_diff, d);
+                    bad += d > opt.tolerance;
+                }
+
+                float fraction = static_cast<float>(bad) / static_cast<float>(img.rgb.size() / 3);
+                ok = fraction <= opt.max_bad_fraction;
+
+                LOG("golden %s: %s, %d pixels over tolerance (%.3f%%), max diff %d",
+                    name.c_str(),
+                    ok ? "ok" : "FAILED",
+                    static_cast<int>(bad),
+                    static_cast<double>(fraction) * 100.0,
+                    max_diff);
+            }
+
+            golden_failed += !ok;
+        }
+    }
+
+    frame++;
+
+    return ok;
+}
+
+void Headless::report() const {
+    if (frame_ns.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> sorted = frame_ns;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto pct = [&](double p) {
+        size_t i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+        return static_cast<double>(sorted[i]) * 1e-6;
+    };
+
+    uint64_t total = 0;
+    for (uint64_t ns : frame_ns) {
+        total += ns;
+    }
+
+    LOG("headless %s: %d frames, mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms",
+        opt.scene.c_str(),
+        static_cast<int>(frame_ns.size()),
+        static_cast<double>(total) * 1e-6 / static_cast<double>(frame_ns.size()),
+        pct(0.5),
+        pct(0.99),
+        pct(1.0));
+
+    if (!opt.out_dir.empty()) {
+        std::string csv = "frame,ms\n";
+        for (size_t i = 0; i < frame_ns.size(); i++) {
+            char line[64];
+            snprintf(line, sizeof(line), "%d,%.4f\n", static_cast<int>(i), static_cast<double>(frame_ns[i]) * 1e-6);
+            csv += line;
+        }
+
+        std::string path = opt.out_dir + opt.scene + "_timings.csv";
+        if (!SDL_SaveFile(path.c_str(), csv.data(), csv.size())) {
+            LOG("can't write %s", path.c_str());
+        }
+    }
+
+    if (!opt.golden_dir.empty() && !opt.update_golden) {
+        LOG("golden images: %d checked, %d failed", golden_checked, golden_failed);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gl_helper.hpp"
+
+// Renders scripted scenes into an FBO without a display, for benchmarks and golden image tests.
+// Uses SDL's offscreen video driver, which creates a surfaceless EGL context (e.g. Mesa llvmpipe).
+//
+//   abc_speak --headless [--frames N] [--size WxH] [--scene SCENE]
+//             [--out DIR] [--dump-every N] [--golden DIR] [--update-golden] [--tolerance N]
+//
+// SCENE is grid, highlight or hud, or one of the benchmark scenes in bench_scene.hpp:
+// shapes, shape_batch, draws, text, glyphs, fill or layer_cache.
+//
+// Frames are dumped as DIR/<scene>_<frame>.ppm. With --golden each dumped frame is compared
+// against the file of the same name, a pixel fails when any channel differs by more than
+// --tolerance and the run fails when more than 0.1% of the pixels do.
+// The hud scene shows live timings so it's only useful for benchmarks.
+// The glyphs scene fails to start without font.ttf in the assets.
+struct HeadlessOptions {
+    bool enabled = false;
+    int frames = 120;
+    int width = 1280;
+    int height = 720;
+    std::string scene = "highlight";
+    std::string out_dir;
+    std::string golden_dir;
+    bool update_golden = false;
+    int dump_every = 30;
+    int tolerance = 2;
+    float max_bad_fraction = 0.001f;
+};
+
+// False on malformed arguments, or unknown ones with --headless. Leaves enabled false when --headless isn't given.
+bool parse_headless_args(int argc, char *argv[], HeadlessOptions &opt);
+
+struct Headless {
+    HeadlessOptions opt;
+    FramebufferPtr fb{{}, {}};
+
+    int frame = 0;
+    std::vector<uint64_t> frame_ns;  // CPU + GPU, glFinish at the end of each frame
+    int golden_checked = 0;
+    int golden_failed = 0;
+
+    bool init(const HeadlessOptions &options);
+
+    // Fixed 60 Hz timeline so animations are reproducible.
+    float time() const { return static_cast<float>(frame) / 60.f; }
+    char scripted_letter() const;
+    bool show_hud() const { return opt.scene == "hud"; }
+    bool done() const { return frame >= opt.frames; }
+
+    void begin_frame();
+    // False when a golden image comparison failed.
+    bool end_frame(uint64_t start_ns);
+
+    void report() const;
+};
@@ -0,0 +1,44 @@
+#include "hud.hpp"
+
+#include <SDL3/SDL_timer.h>
+
+#include <cstdio>
+
+namespace {
+constexpr uint64_t HUD_UPDATE_NS = SDL_NS_PER_SECOND / 4;
+constexpr float HUD_FONT_WIDTH = 0.02f;
+constexpr glm::vec2 HUD_POS{0.01f, 0.02f};  // baseline of the text
+}  // namespace
+
+void Hud::update(const Profiler &profiler, const TextBatch &batch) {
+    uint64_t now = SDL_GetTicksNS();
+
+    if (!str.empty() && now - last_update_ns < HUD_UPDATE_NS) {
+        return;
+    }
+
+    last_update_ns = now;
+
+    float interval = profiler.frame_interval.mean();
+    float fps = interval > 0.f ? 1000.f / interval : 0.f;
+
+    char gpu[32] = "n/a";
+    if (profiler.gpu_timer.supported) {
+        snprintf(gpu, sizeof(gpu), "%.2f ms", static_cast<double>(profiler.gpu.mean()));
+    }
+
+    char buf[160];
+    snprintf(buf,
+             sizeof(buf),
+             "FPS %.0f  p99 %.1f ms  CPU %.2f ms  GPU %s  decode %.1f ms  text %.0f glyphs/ms",
+             static_cast<double>(fps),
+             static_cast<double>(profiler.frame_interval.percentile(0.99f)),
+             static_cast<double>(profiler.stage(Stage::frame).mean()),
+             gpu,
+             static_cast<double>(profiler.decode.last()),
+             static_cast<double>(batch.glyphs_per_ms()));
+
+    str = buf;
+}
+
+void Hud::draw(FontAtlas &font, TextBatch &batch) const { batch.add(font, str, HUD_POS, HUD_FONT_WIDTH); }
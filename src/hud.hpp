@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "font.hpp"
+#include "gl_helper.hpp"
+#include "profiler.hpp"
+#include "text_batch.hpp"
+
+// On-screen frame statistics, toggled at runtime.
+struct Hud {
+    bool visible = false;
+
+    std::string str;
+    uint64_t last_update_ns = 0;
+
+    // Rebuilds the text a few times a second, no point doing it every frame.
+    void update(const Profiler &profiler, const TextBatch &batch);
+    void draw(FontAtlas &font, TextBatch &batch) const;
+};
@@ -0,0 +1,88 @@
+#include "layer_cache.hpp"
+
+#include <SDL3/SDL_opengles2.h>
+
+#include <vector>
+
+#include "log.hpp"
+
+namespace {
+const char *blit_vertex_shader = R"(#version 300 es
+precision mediump float;
+
+layout(location = 0) in vec2 pos; // [0, 1]
+out vec2 texCoord;
+
+void main() {
+    gl_Position = vec4(pos*2.0 - 1.0, 0.0, 1.0);
+    texCoord = pos;
+})";
+
+const char *blit_fragment_shader = R"(#version 300 es
+precision mediump float;
+
+in vec2 texCoord;
+out vec4 color;
+uniform sampler2D tex;
+
+void main() {
+    color = texture(tex, texCoord);
+})";
+}  // namespace
+
+bool LayerCache::init() {
+    blit_shader = make_shader(blit_vertex_shader, blit_fragment_shader);
+
+    // tex keeps the default texture unit 0, so nothing waits for the link here
+
+    std::vector<glm::vec2> vertex{{0.f, 0.f}, {1.f, 0.f}, {1.f, 1.f}, {0.f, 1.f}};
+    quad = make_vertex_buffer(vertex, {0, 1, 2, 0, 2, 3});
+
+    return true;
+}
+
+bool LayerCache::resize(int width, int height) {
+    valid = false;
+
+    if (fb && fb->width() == width && fb->height() == height) {
+        return true;
+    }
+
+    fb = make_framebuffer(width, height);
+
+    if (!fb) {
+        LOG("can't create layer cache framebuffer %dx%d", width, height);
+        return false;
+    }
+
+    return true;
+}
+
+void LayerCache::begin() {
+    assert(fb);
+
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fb->fbo);
+
+    // straight alpha draws blend their color as usual and add up coverage in alpha, which keeps the layer premultiplied
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void LayerCache::end() {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(prev_fbo));
+    valid = true;
+    rebuilds++;
+}
+
+void LayerCache::draw() {
+    assert(fb);
+
+    frames_served++;
+
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    draw_vertex_buffer(blit_shader, quad, fb->color);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include "gl_helper.hpp"
+
+// Caches the static part of the scene in an offscreen texture.
+// Render the static content between begin() and end() when the cache is invalid,
+// then draw() blends it over the current framebuffer every frame.
+// The layer holds premultiplied alpha and starts out transparent. Straight alpha draws need no change in between,
+// premultiplied ones (FontShader::set_premultiplied) set glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+// end() and draw() leave the usual straight alpha blend behind.
+struct LayerCache {
+    FramebufferPtr fb{{}, {}};
+    ShaderPtr blit_shader{{}, {}};
+    VertexBufferPtr quad{{}, {}};
+
+    bool valid = false;
+    GLint prev_fbo = 0;
+
+    uint64_t rebuilds = 0;
+    uint64_t frames_served = 0;
+
+    bool init();
+
+    // Recreates the texture if the size changed. Always invalidates.
+    bool resize(int width, int height);
+    void invalidate() { valid = false; }
+
+    void begin();
+    void end();
+    void draw();
+};
@@ -3,6 +3,7 @@
 
 #define SDL_MAIN_USE_CALLBACKS  // use the callbacks instead of main()
 #include <SDL3/SDL.h>
+#include <SDL3/SDL_filesystem.h>
 #include <SDL3/SDL_init.h>
 #include <SDL3/SDL_iostream.h>
 #include <SDL3/SDL_main.h>
@@ -11,6 +12,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 #include <glm/glm.hpp>
@@ -18,11 +20,23 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
 
+#include "bench_scene.hpp"
 #include "color_palette.hpp"
 #include "font.hpp"
 #include "geometry.hpp"
+#include "glyph_cache.hpp"
 #include "gl_helper.hpp"
+#include "headless.hpp"
+#include "hud.hpp"
+#include "layer_cache.hpp"
 #include "log.hpp"
+#include "profiler.hpp"
+#include "render_thread.hpp"
+#include "shader_cache.hpp"
+#include "task_graph.hpp"
+#include "text_batch.hpp"
+#include "trace.hpp"
+#include "triple_buffer.hpp"
 #include "vosk_api.h"
 
 // All co-ordinates used are normalized as follows
@@ -42,11 +56,79 @@ constexpr glm::vec4 FONT_OUTLINE = Color::white;
 constexpr float FONT_OUTLINE_FACTOR = 0.1f;
 constexpr float FONT_WIDTH = 0.15f;
 
+constexpr glm::vec4 TEXT_COLOR = Color::white;
+
+// highlighted letter glows between half and full brightness
+constexpr float HIGHLIGHT_SCALE = 1.2f;
+constexpr float HIGHLIGHT_FREQ = 0.75f;  // Hz
+constexpr float HIGHLIGHT_LO = 0.5f;
+// pulses before the letter settles at mid brightness and goes into the layer cache
+constexpr float HIGHLIGHT_PULSES = 3.f;
+
+constexpr std::array<glm::vec4, 9> LETTER_COLOR{
+    Color::blue,
+    Color::orange,
+    Color::red,
+    Color::teal,
+    Color::green,
+    Color::yellow,
+    Color::purple,
+    Color::pink,
+    Color::brown,
+};
+
 constexpr int AUDIO_RATE = 16000;
 
+// How long to block waiting for events when there's nothing to redraw.
+constexpr int IDLE_WAIT_MS = 250;
+
 using VoskModelPtr = std::unique_ptr<VoskModel, void (*)(VoskModel *)>;
 using VoskRecognizerPtr = std::unique_ptr<VoskRecognizer, void (*)(VoskRecognizer *)>;
 
+// Only redraw when something on screen changed or is animating.
+// Everything else blocks on the event queue instead of redrawing every vsync.
+struct FrameScheduler {
+    bool dirty = true;
+
+    uint64_t frames_rendered = 0;
+    uint64_t frames_skipped = 0;  // vsync intervals nothing was drawn in
+    uint64_t render_cpu_ns = 0;   // total CPU time spent rendering
+
+    uint64_t interval_ns = SDL_NS_PER_SECOND / 60;  // display refresh interval
+    uint64_t last_frame_ns = 0;
+
+    void invalidate() { dirty = true; }
+
+    void frame_rendered(uint64_t start_ns, uint64_t end_ns) {
+        count_skipped(end_ns);
+        frames_rendered++;
+        render_cpu_ns += end_ns - start_ns;
+    }
+
+    // Counts the intervals since the last frame that nothing was drawn in, call it once more at exit.
+    void count_skipped(uint64_t now_ns) {
+        if (last_frame_ns != 0 && now_ns > last_frame_ns) {
+            uint64_t intervals = (now_ns - last_frame_ns + interval_ns / 2) / interval_ns;
+            frames_skipped += intervals > 1 ? intervals - 1 : 0;
+        }
+
+        last_frame_ns = now_ns;
+    }
+
+    uint64_t avg_render_cpu_ns() const { return frames_rendered ? render_cpu_ns / frames_rendered : 0; }
+    uint64_t cpu_ns_saved() const { return frames_skipped * avg_render_cpu_ns(); }
+};
+
+// Everything a frame needs from the main thread.
+// With --render-thread the renderer only ever sees copies of this, passed through a triple buffer.
+struct SceneSnapshot {
+    int width = 0;  // window size in points
+    int height = 0;
+    char letter = 0;
+    bool hud_visible = false;
+    uint64_t input_ns = 0;  // timestamp of the newest input shown by this scene, 0 if none
+};
+
 struct AppState {
     SDL_Window *window = nullptr;
     SDL_Renderer *renderer = nullptr;
@@ -59,28 +141,83 @@ struct AppState {
 
     bool init = false;
 
-    VertexArrayPtr vao{{}, {}};
+    // assets.pak or the loose files in the asset directory
+    Vfs vfs;
 
     FontAtlas font;
     FontShader font_shader;
 
+    // characters the atlas lacks, generated from assets/font.ttf when it's there
+    GlyphCache glyph_cache;
+
     ShapeShader shape_shader;
-    Shape draw_area_bg;
+    SdfShape draw_area_bg;
+
+    // shared by every quad buffer of the context
+    QuadIndexPtr quad_index{{}, {}};
 
-    VertexBufferPtr letter{{}, {}};
+    // all 26 letters in one buffer, letter i uses animation slot i + 1
+    VertexBufferPtr letter_grid{{}, {}};
     std::array<glm::vec2, 26> letter_center;
+    char highlighted_letter = 0;  // letter the animation uniforms were last set for
+    float highlight_end = 0.f;    // anim time the pulse settles at, 0 once it did
+    float letter_grid_area = 0;   // sum of letter quad areas, normalized units
 
-    char spoken_letter = 0;
-};
+    // background and static letters
+    LayerCache layer_cache;
+
+    // written by the audio thread
+    std::atomic<char> spoken_letter = 0;
+    Uint32 recognition_event = 0;
+
+    // the model and audio may still be loading after SDL_AppInit returns
+    TaskGraph startup;
+    size_t first_frame_task = 0;
+    size_t listening_task = 0;
+    bool startup_logged = false;
+    bool first_frame_drawn = false;  // renderer side
+
+    FrameScheduler scheduler;
+
+    Profiler profiler;
+    Hud hud;
 
-bool resize_event(AppState &as) {
-    int win_w, win_h;
+    // dynamic text, flushed once per frame
+    TextBatch text_batch;
+
+    // --headless, scripted scenes rendered to an FBO
+    Headless headless;
+    BenchScene bench;
+
+    // main thread state, copied for every frame
+    SceneSnapshot scene;
+
+    // renderer side
+    int viewport_w = 0;
+    int viewport_h = 0;
+    uint64_t presented_input_ns = 0;
+
+    // --render-thread, the GL context lives on render_thread
+    bool threaded = false;
+    TripleBuffer<SceneSnapshot> scenes;
+    RenderThread render_thread;
+};
 
-    if (!SDL_GetWindowSize(as.window, &win_w, &win_h)) {
+// main thread
+bool update_window_size(AppState &as) {
+    if (!SDL_GetWindowSize(as.window, &as.scene.width, &as.scene.height)) {
         LOG("%s", SDL_GetError());
         return false;
     }
 
+    return true;
+}
+
+// render side, called when the scene size changes
+bool resize_viewport(AppState &as, int win_w, int win_h) {
+    as.viewport_w = win_w;
+    as.viewport_h = win_h;
+
     float win_wf = static_cast<float>(win_w);
     float win_hf = static_cast<float>(win_h);
 
@@ -112,6 +249,10 @@ bool resize_event(AppState &as) {
     as.font_shader.set_ortho(ortho);
     as.font_shader.set_display_width(draw_area_size.x);
 
+    if (!as.layer_cache.resize(win_w, win_h)) {
+        return false;
+    }
+
     return true;
 }
 
@@ -120,6 +261,9 @@ void record_callback(void *userdata, SDL_AudioStream *stream, int additional_amo
 
     AppState &as = *static_cast<AppState *>(userdata);
 
+    TRACE_THREAD("audio");
+    TRACE_ZONE("record_callback");
+
     if (!as.recognizer) {
         return;
     }
@@ -151,16 +295,25 @@ void record_callback(void *userdata, SDL_AudioStream *stream, int additional_amo
         return str.substr(start + 1, end - start - 1);
     };
 
-    int done = vosk_recognizer_accept_waveform(as.recognizer.get(), buf.data(), total_amount);
+    uint64_t decode_start = SDL_GetTicksNS();
 
     std::string word;
-    if (done) {
-        word = parse_json(vosk_recognizer_final_result(as.recognizer.get()));
-        vosk_recognizer_reset(as.recognizer.get());
-    } else {
-        word = parse_json(vosk_recognizer_partial_result(as.recognizer.get()));
+
+    {
+        TRACE_ZONE("vosk decode");
+
+        int done = vosk_recognizer_accept_waveform(as.recognizer.get(), buf.data(), total_amount);
+
+        if (done) {
+            word = parse_json(vosk_recognizer_final_result(as.recognizer.get()));
+            vosk_recognizer_reset(as.recognizer.get());
+        } else {
+            word = parse_json(vosk_recognizer_partial_result(as.recognizer.get()));
+        }
     }
 
+    as.profiler.add_decode_sample(SDL_GetTicksNS() - decode_start);
+
     if (!word.empty()) {
         // LOG("Word: %s", word.c_str());
     }
@@ -169,11 +322,19 @@ void record_callback(void *userdata, SDL_AudioStream *stream, int additional_amo
         // if the final word contains multiple words pick the letter of the last word
         std::reverse(word.begin(), word.end());
 
+        char letter = 0;
         for (auto ch : word) {
             if (ch == ' ') {
                 break;
             }
-            as.spoken_letter = static_cast<char>(std::toupper(ch));
+            letter = static_cast<char>(std::toupper(ch));
+        }
+
+        if (as.spoken_letter.exchange(letter) != letter) {
+            // wake up the main thread in case it's idle
+            SDL_Event event{};
+            event.type = as.recognition_event;
+            SDL_PushEvent(&event);
         }
     }
 }
@@ -193,11 +354,30 @@ bool init_audio(AppState &as) {
 
     SDL_ResumeAudioStreamDevice(as.recording_stream);
 
+    LOG("listening after %.1f ms", static_cast<double>(SDL_GetTicksNS()) * 1e-6);
+
     return true;
 }
 
-bool init_font(AppState &as, const std::string &asset_path) {
-    if (!as.font.load(asset_path + "atlas.bmp", asset_path + "atlas.txt")) {
+// Starts compiling every program up front so the driver can link them while the model and atlas load.
+bool submit_shaders(AppState &as) {
+    // the style is fixed, this picks the shader variant
+    as.font_shader.set_bg(FONT_BG);
+    as.font_shader.set_outline(FONT_OUTLINE);
+    as.font_shader.set_outline_factor(FONT_OUTLINE_FACTOR);
+    as.font_shader.prepare();
+
+    // the same style drawn into the layer cache
+    as.font_shader.set_premultiplied(true);
+    as.font_shader.prepare();
+    as.font_shader.set_premultiplied(false);
+
+    return as.shape_shader.init() && as.layer_cache.init();
+}
+
+// GL side of the font, font.prepare has read and decoded the atlas on a worker.
+bool init_font(AppState &as) {
+    if (!as.font.upload()) {
         return false;
     }
 
@@ -205,9 +385,95 @@ bool init_font(AppState &as, const std::string &asset_path) {
         return false;
     }
 
+    // waits for the variant submitted by submit_shaders
+    if (!as.font_shader.shader()) {
+        return false;
+    }
+
     return true;
 }
 
+float anim_time(const AppState &as) {
+    if (as.headless.opt.enabled) {
+        return as.headless.time();
+    }
+
+    return static_cast<float>(static_cast<double>(SDL_GetTicksNS()) * 1e-9);
+}
+
+int letter_slot(char letter) { return letter - 'A' + 1; }
+
+void make_letter_grid(AppState &as) {
+    std::vector<LetterVertex> vertex;
+
+    for (size_t i = 0; i < 26; i++) {
+        std::string str(1, static_cast<char>('A' + i));
+
+        TextLayoutPtr layout = as.font.layout(str, true);
+        const BBox &b = layout->bbox;
+
+        // center the letter on its pivot
+        glm::vec2 center = (b.start + b.end) * 0.5f;
+
+        glm::vec2 size = (b.end - b.start) * FONT_WIDTH;
+        as.letter_grid_area += size.x * size.y;
+
+        for (const auto &v : layout->vertex_uv) {
+            glm::vec4 local{v.x - center.x, v.y - center.y, v.z, v.w};
+            vertex.push_back(make_letter_vertex(local, as.letter_center[i], letter_slot(str[0]), 1.f));
+        }
+    }
+
+    size_t bytes = sizeof(LetterVertex) * vertex.size();
+    as.letter_grid =
+        make_quad_vertex_buffer(*as.quad_index, vertex.data(), bytes, vertex.size() / 4, LAYOUT_POS_UV_LETTER);
+
+    // previously 8 floats per vertex and 32 bit indices per buffer
+    size_t unpacked = vertex.size() * sizeof(float) * 8 + (vertex.size() / 4) * 6 * sizeof(uint32_t);
+    LOG("letter grid: %d bytes of vertex data, indices shared (%d bytes unpacked)",
+        static_cast<int>(bytes),
+        static_cast<int>(unpacked));
+}
+
+// Only called when the spoken letter changes, the shader does the per frame work.
+void update_letter_anim(AppState &as, char letter) {
+    if (as.highlighted_letter != 0) {
+        as.font_shader.set_anim(letter_slot(as.highlighted_letter), LetterAnim{});
+    }
+
+    if (letter >= 'A' && letter <= 'Z') {
+        glm::vec4 hi = LETTER_COLOR[static_cast<size_t>(letter - 'A') % LETTER_COLOR.size()];
+        glm::vec4 lo = hi * HIGHLIGHT_LO;
+        lo.a = 1.f;
+
+        LetterAnim anim;
+        anim.start_time = anim_time(as);
+        anim.frequency = HIGHLIGHT_FREQ;
+        anim.scale = HIGHLIGHT_SCALE;
+        anim.color_lo = lo;
+        anim.color_hi = hi;
+
+        as.font_shader.set_anim(letter_slot(letter), anim);
+        as.highlight_end = anim.start_time + HIGHLIGHT_PULSES / HIGHLIGHT_FREQ;
+    } else {
+        as.highlight_end = 0.f;
+    }
+
+    as.highlighted_letter = letter;
+}
+
+// Holds the highlighted letter where the pulse ended. Without a frequency it's a static letter.
+void settle_letter_anim(AppState &as) {
+    int slot = letter_slot(as.highlighted_letter);
+    LetterAnim anim = as.font_shader.uniform.anim[static_cast<size_t>(slot)];
+    anim.frequency = 0.f;
+    anim.color_lo = (anim.color_lo + anim.color_hi) * 0.5f;
+    anim.color_hi = anim.color_lo;
+
+    as.font_shader.set_anim(slot, anim);
+    as.highlight_end = 0.f;
+}
+
 bool init_vosk_android() {
 #ifdef __ANDROID__
     std::string vosk_path = std::string(SDL_GetAndroidExternalStoragePath()) + "/" + VOSK_MODEL;
@@ -310,86 +576,257 @@ bool init_vosk_model(AppState &as, const std::string &model_path) {
     return true;
 }
 
-SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
-    // Unused
-    (void)argc;
-    (void)argv;
+// the highlighted letter pulses for a while and the HUD updates, so keep drawing while either is going on
+bool animating(const AppState &as, const SceneSnapshot &scene) {
+    return (scene.letter != 0 && as.highlight_end > 0.f) || scene.hud_visible || as.headless.opt.enabled;
+}
 
-    if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO)) {
-        LOG("SDL_Init failed: %s", SDL_GetError());
-        return SDL_APP_FAILURE;
+// --scene shapes and the other benchmark scenes, drawn over the regular frame.
+void draw_bench(AppState &as) {
+    BenchScene &bench = as.bench;
+    int frame = as.headless.frame;
+
+    if (bench.name == "shapes") {
+        bench.draw_shapes(as.shape_shader, frame, glm::vec2{NORM_WIDTH, NORM_HEIGHT});
+    } else if (bench.name == "shape_batch") {
+        bench.draw_shape_batch(as.shape_shader, frame, glm::vec2{NORM_WIDTH, NORM_HEIGHT});
+    } else if (bench.name == "draws") {
+        bench.draw_calls(as.shape_shader, glm::vec2{NORM_WIDTH, NORM_HEIGHT});
+    } else if (bench.name == "text") {
+        bench.draw_text(as.font_shader, as.font, *as.quad_index, frame, glm::vec2{NORM_WIDTH, NORM_HEIGHT});
+    } else if (bench.name == "glyphs") {
+        bench.text.glyph_cache = as.text_batch.glyph_cache;
+        bench.draw_text(as.font_shader, as.font, *as.quad_index, frame, glm::vec2{NORM_WIDTH, NORM_HEIGHT});
+    } else if (bench.name == "fill") {
+        float w = as.shape_shader.draw_area_size.x;
+        auto fragments = static_cast<uint64_t>(as.letter_grid_area * w * w);
+        bench.draw_fill(as.font_shader, as.letter_grid, as.font.tex, fragments, frame);
     }
+}
 
-    AppState *as = new AppState();
+// Draws one frame into the current framebuffer, only touches renderer side state.
+void render_frame(AppState &as, const SceneSnapshot &scene) {
+    Profiler &prof = as.profiler;
+    prof.begin_frame();
 
-    if (!as) {
-        LOG("can't alloc memory for AppState");
-        return SDL_APP_FAILURE;
+    {
+        ScopedTimer frame_timer(prof.stage(Stage::frame));
+        TRACE_ZONE("frame");
+
+        if (!as.init || scene.width != as.viewport_w || scene.height != as.viewport_h) {
+            resize_viewport(as, scene.width, scene.height);
+            as.init = true;
+        }
+
+        glDisable(GL_DEPTH_TEST);
+        glClearColor(0.0, 0.0, 0.0, 1.0);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        {
+            ScopedTimer t(prof.stage(Stage::update));
+            TRACE_ZONE("update");
+
+            as.font_shader.set_font_width(FONT_WIDTH);
+            as.font_shader.set_trans(glm::vec2{0.f});
+
+            if (scene.letter != as.highlighted_letter) {
+                update_letter_anim(as, scene.letter);
+                as.layer_cache.invalidate();
+            } else if (as.highlight_end > 0.f && anim_time(as) >= as.highlight_end) {
+                settle_letter_anim(as);
+                as.layer_cache.invalidate();
+            }
+
+            as.hud.visible = scene.hud_visible;
+            as.font_shader.set_time(anim_time(as));
+
+            as.glyph_cache.update();
+        }
+
+        bool bench_layer = as.headless.opt.enabled && as.bench.name == "layer_cache";
+
+        if (bench_layer) {
+            as.bench.begin_layer(as.layer_cache, as.headless.frame);
+        }
+
+        if (!as.layer_cache.valid) {
+            ScopedTimer t(prof.stage(Stage::cache));
+            TRACE_ZONE("layer cache");
+
+            as.layer_cache.begin();
+
+            draw_sdf_shape(as.shape_shader, as.draw_area_bg, true, false, false);
+
+            as.font_shader.set_anim_pass(AnimPass::static_only);
+            as.font_shader.set_premultiplied(true);
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            draw_vertex_buffer(as.font_shader.shader(), as.letter_grid, as.font.tex);
+            as.font_shader.set_premultiplied(false);
+
+            as.layer_cache.end();
+        }
+
+        {
+            ScopedTimer t(prof.stage(Stage::draw));
+            TRACE_ZONE("draw");
+
+            as.layer_cache.draw();
+
+            if (bench_layer) {
+                as.bench.end_layer(as.headless.frame);
+            }
+
+            if (as.highlight_end > 0.f) {
+                as.font_shader.set_anim_pass(AnimPass::animated_only);
+                draw_vertex_buffer(as.font_shader.shader(), as.letter_grid, as.font.tex);
+            }
+
+            if (as.headless.opt.enabled) {
+                draw_bench(as);
+            }
+        }
+
+        if (as.hud.visible) {
+            ScopedTimer t(prof.stage(Stage::hud));
+            TRACE_ZONE("hud");
+
+            as.hud.update(prof, as.text_batch);
+            as.hud.draw(as.font, as.text_batch);
+
+            as.font_shader.set_fg(TEXT_COLOR);
+            as.text_batch.flush(as.font_shader, as.font, *as.quad_index);
+        }
     }
 
-    *appstate = as;
+    prof.end_frame();
 
-    std::string asset_path = "assets/";
-    std::string model_path = "assets/";
+    if (!as.first_frame_drawn) {
+        as.first_frame_drawn = true;
+        LOG("first frame drawn after %.1f ms", static_cast<double>(SDL_GetTicksNS()) * 1e-6);
+    }
+}
 
-#ifdef __ANDROID__
-    asset_path = "";
-    if (!init_vosk_android()) {
-        return SDL_APP_FAILURE;
+void present(AppState &as, const SceneSnapshot &scene) {
+    {
+        ScopedTimer t(as.profiler.stage(Stage::swap));
+        TRACE_ZONE("swap");
+        SDL_GL_SwapWindow(as.window);
     }
 
-    model_path = std::string(SDL_GetAndroidExternalStoragePath()) + "/";
-#endif
+    // the swap returning is as close to photons as we can observe
+    if (scene.input_ns != 0 && scene.input_ns != as.presented_input_ns) {
+        as.profiler.input_latency.add(ns_to_ms(SDL_GetTicksNS() - scene.input_ns));
+        as.presented_input_ns = scene.input_ns;
+    }
+}
 
-    if (!init_vosk_model(*as, model_path)) {
-        return SDL_APP_FAILURE;
+// Body of the render thread, owns the GL context until the thread stops.
+void render_loop(AppState &as) {
+    TRACE_THREAD("render");
+    SDL_GL_MakeCurrent(as.window, as.gl_ctx);
+
+    while (as.render_thread.running) {
+        bool fresh = as.scenes.update();
+        const SceneSnapshot &scene = as.scenes.front();
+
+        if (!fresh && !animating(as, scene) && as.init) {
+            TRACE_ZONE("wait scene");
+            as.render_thread.wait();
+            continue;
+        }
+
+        uint64_t render_start = SDL_GetTicksNS();
+
+        render_frame(as, scene);
+
+        as.scheduler.frame_rendered(render_start, SDL_GetTicksNS());
+
+        present(as, scene);
     }
 
-    if (!init_audio(*as)) {
-        return SDL_APP_FAILURE;
+    SDL_GL_MakeCurrent(as.window, nullptr);
+}
+
+// Chrome trace of everything so far, only in -DTRACE=ON builds. Saved on exit and when T is pressed.
+void save_trace() {
+    if (!TRACE_ENABLED) {
+        return;
     }
 
+    if (char *pref_path = SDL_GetPrefPath("abc-speak", "abc-speak")) {
+        trace_write(std::string(pref_path) + "trace.json");
+        SDL_free(pref_path);
+    }
+}
+
+bool init_window(AppState &as, const HeadlessOptions &headless) {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
+    // shapes and glyphs anti-alias in their fragment shaders, MSAA would only cost bandwidth
+    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
     // Android
     SDL_SetHint(SDL_HINT_ORIENTATIONS, "LandscapeLeft LandscapeRight");
 
-    if (!SDL_CreateWindowAndRenderer("ABC Speak",
-                                     640,
-                                     480,
-                                     SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL | SDL_WINDOW_BORDERLESS,
-                                     &as->window,
-                                     &as->renderer)) {
+    if (headless.enabled) {
+        as.window = SDL_CreateWindow("ABC Speak", headless.width, headless.height, SDL_WINDOW_OPENGL);
+
+        if (!as.window) {
+            LOG("SDL_CreateWindow failed: %s", SDL_GetError());
+            return false;
+        }
+    } else if (!SDL_CreateWindowAndRenderer("ABC Speak",
+                                            640,
+                                            480,
+                                            SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL | SDL_WINDOW_BORDERLESS,
+                                            &as.window,
+                                            &as.renderer)) {
         LOG("SDL_CreateWindowAndRenderer failed: %s", SDL_GetError());
-        return SDL_APP_FAILURE;
+        return false;
     }
 
-    if (!SDL_SetRenderVSync(as->renderer, 1)) {
-        LOG("SDL_SetRenderVSync failed");
-        return SDL_APP_FAILURE;
+    if (!headless.enabled) {
+        if (!SDL_SetRenderVSync(as.renderer, 1)) {
+            LOG("SDL_SetRenderVSync failed");
+            return false;
+        }
+
+        const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(as.window));
+
+        if (mode && mode->refresh_rate > 0.f) {
+            as.scheduler.interval_ns = static_cast<uint64_t>(static_cast<double>(SDL_NS_PER_SECOND) /
+                                                             static_cast<double>(mode->refresh_rate));
+        }
+
+        SDL_SetWindowFullscreen(as.window, true);
     }
 
-    SDL_SetWindowFullscreen(as->window, true);
+    return true;
+}
 
+bool init_gl_context(AppState &as) {
 #ifndef __EMSCRIPTEN__
-    as->gl_ctx = SDL_GL_CreateContext(as->window);
-    SDL_GL_MakeCurrent(as->window, as->gl_ctx);
+    as.gl_ctx = SDL_GL_CreateContext(as.window);
+    SDL_GL_MakeCurrent(as.window, as.gl_ctx);
     enable_gl_debug_callback();
-#endif
 
-    if (!init_font(*as, asset_path)) {
-        return SDL_APP_FAILURE;
-    }
+    init_parallel_shader_compile();
 
-    if (!as->shape_shader.init()) {
-        return SDL_APP_FAILURE;
+    if (char *pref_path = SDL_GetPrefPath("abc-speak", "abc-speak")) {
+        init_shader_cache(std::string(pref_path) + "shader_cache/");
+        SDL_free(pref_path);
     }
+#endif
 
-    as->vao = make_vertex_array();
+    as.profiler.gpu_timer.init();
+    as.quad_index = make_quad_index();
 
+    return true;
+}
+
+// Everything the first frame draws, once the font is uploaded and the shaders are linked.
+bool init_scene(AppState &as) {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
@@ -397,20 +834,12 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     {
         float h = 1.0f / ASPECT_RATIO;
 
-        std::vector<glm::vec2> vertex{
-            {0.f, 0.f},
-            {1.f, 0.f},
-            {1.f, h},
-            {0.f, h},
-        };
-
-        as->draw_area_bg = make_shape(vertex, 0, {}, BG_COLOR);
+        as.draw_area_bg = make_sdf_rounded_rect(glm::vec2{0.5f, h * 0.5f}, 0.f, 0.f, {}, BG_COLOR);
+        as.draw_area_bg.trans = glm::vec2{0.5f, h * 0.5f};
     }
 
     // letter position
     {
-        std::tie(as->letter, std::ignore) = as->font.make_text("A", true);
-
         int rows = 4;
         int cols = 7;
         float xoff = FONT_WIDTH * 0.5f;
@@ -422,7 +851,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
                 float x = xoff + (static_cast<float>(j) / static_cast<float>(cols)) * NORM_WIDTH;
                 float y = yoff + (static_cast<float>(i) / static_cast<float>(rows)) * NORM_HEIGHT;
 
-                as->letter_center[count] = {x, y};
+                as.letter_center[count] = {x, y};
 
                 count++;
 
@@ -431,6 +860,160 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
                 }
             }
         }
+
+        make_letter_grid(as);
+
+        for (char ch = 'A'; ch <= 'Z'; ch++) {
+            as.font_shader.set_anim(letter_slot(ch), LetterAnim{});
+        }
+    }
+
+    return update_window_size(as);
+}
+
+SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
+    TRACE_THREAD("main");
+    TRACE_ZONE("SDL_AppInit");
+
+    bool threaded = false;
+    std::vector<char *> args;
+
+    for (int i = 0; i < argc; i++) {
+        if (std::string(argv[i]) == "--render-thread") {
+            threaded = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    HeadlessOptions headless;
+
+    if (!parse_headless_args(static_cast<int>(args.size()), args.data(), headless)) {
+        return SDL_APP_FAILURE;
+    }
+
+#ifdef __EMSCRIPTEN__
+    threaded = false;
+#endif
+
+    if (threaded && headless.enabled) {
+        LOG("--render-thread is ignored in headless mode");
+        threaded = false;
+    }
+
+    if (headless.enabled) {
+        // surfaceless EGL, works without a display or GPU
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    }
+
+    if (!SDL_Init(headless.enabled ? SDL_INIT_VIDEO : SDL_INIT_VIDEO | SDL_INIT_AUDIO)) {
+        LOG("SDL_Init failed: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    AppState *as = new AppState();
+
+    if (!as) {
+        LOG("can't alloc memory for AppState");
+        return SDL_APP_FAILURE;
+    }
+
+    *appstate = as;
+
+    std::string asset_path = "assets/";
+    std::string model_path = "assets/";
+
+#ifdef __ANDROID__
+    asset_path = "";
+    model_path = std::string(SDL_GetAndroidExternalStoragePath()) + "/";
+#endif
+
+    // registered here so the main thread never reads it while the audio task writes it
+    as->recognition_event = SDL_RegisterEvents(1);
+    as->glyph_cache.ready_event = SDL_RegisterEvents(1);
+
+    // Files, decoding and the model load on workers, window, context and uploads on this thread, each as
+    // soon as its inputs are ready. The first frame only waits for the GL side, listening starts later.
+    TaskGraph &g = as->startup;
+
+    size_t window = g.add("window", TaskThread::gl, [as, headless]() { return init_window(*as, headless); });
+    size_t context = g.add("context", TaskThread::gl, [as]() { return init_gl_context(*as); }, {window});
+    size_t shaders = g.add("shaders", TaskThread::gl, [as]() { return submit_shaders(*as); }, {context});
+
+    size_t mount = g.add("mount", TaskThread::worker, [as, asset_path]() {
+        if (!as->vfs.mount(asset_path)) {
+            LOG("reading loose asset files instead");
+        }
+        return true;
+    });
+
+    size_t atlas = g.add(
+        "atlas", TaskThread::worker, [as]() { return as->font.prepare(as->vfs, "atlas.bmp", "atlas.txt"); }, {mount});
+    size_t font = g.add("font", TaskThread::gl, [as]() { return init_font(*as); }, {atlas, shaders});
+
+    // optional, same em size and range as the atlas so the font shader uniforms fit both
+    // except for the glyphs scene, which measures the cache and would only time '?' without it
+    bool need_glyphs = headless.enabled && headless.scene == "glyphs";
+    size_t glyphs = g.add(
+        "glyph_cache",
+        TaskThread::worker,
+        [as, need_glyphs]() {
+            if (as->glyph_cache.init(as->vfs, "font.ttf", as->font.em_size, as->font.distance_range)) {
+                as->text_batch.glyph_cache = &as->glyph_cache;
+            } else if (need_glyphs) {
+                LOG("the glyphs scene needs font.ttf in the assets");
+                return false;
+            } else {
+                LOG("no glyph cache, characters missing from the atlas draw as '?'");
+            }
+            return true;
+        },
+        {font});
+
+    size_t linked = g.add(
+        "link",
+        TaskThread::gl,
+        [as]() {
+            return as->shape_shader.shader->wait() && as->shape_shader.instanced_shader->wait() &&
+                   as->shape_shader.sdf_shader->wait() && as->layer_cache.blit_shader->wait();
+        },
+        {shaders});
+
+    std::vector<size_t> scene_deps{font, glyphs, linked};
+
+    if (headless.enabled) {
+        scene_deps.push_back(
+            g.add("headless", TaskThread::gl, [as, headless]() { return as->headless.init(headless); }, {context}));
+        as->bench.name = headless.scene;
+    }
+
+    as->first_frame_task = g.add("scene", TaskThread::gl, [as]() { return init_scene(*as); }, scene_deps);
+
+    // headless runs don't listen
+    if (!headless.enabled) {
+        size_t files = g.add("model_files", TaskThread::worker, []() { return init_vosk_android(); });
+        size_t model = g.add(
+            "model", TaskThread::worker, [as, model_path]() { return init_vosk_model(*as, model_path); }, {files});
+        as->listening_task = g.add("audio", TaskThread::worker, [as]() { return init_audio(*as); }, {model});
+    }
+
+    if (!g.run()) {
+        return SDL_APP_FAILURE;
+    }
+
+    if (threaded) {
+        // hand the context over, from here on the main thread only does events and window management
+        SDL_GL_MakeCurrent(as->window, nullptr);
+
+        as->scenes.back() = as->scene;
+        as->scenes.publish();
+        as->scheduler.dirty = false;
+
+        as->threaded = as->render_thread.start([as]() { render_loop(*as); });
+
+        if (!as->threaded) {
+            SDL_GL_MakeCurrent(as->window, as->gl_ctx);
+        }
     }
 
     return SDL_APP_CONTINUE;
@@ -439,13 +1022,15 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
     AppState &as = *static_cast<AppState *>(appstate);
 
+    TRACE_ZONE("SDL_AppEvent");
+
     switch (event->type) {
         case SDL_EVENT_QUIT:
             return SDL_APP_SUCCESS;
         case SDL_EVENT_KEY_DOWN:
 #ifndef __EMSCRIPTEN__
             if (event->key.key == SDLK_ESCAPE) {
-                SDL_Quit();
+                // SDL_AppQuit joins the startup workers and the render thread before SDL shuts down
                 return SDL_APP_SUCCESS;
             }
 #endif
@@ -456,12 +1041,28 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
                 } else {
                     SDL_SetWindowFullscreen(as.window, true);
                 }
+                as.scheduler.invalidate();
+            }
+
+            if (event->key.key == SDLK_T) {
+                save_trace();
+            }
+
+            if (event->key.key == SDLK_H) {
+                as.scene.hud_visible = !as.scene.hud_visible;
+                as.scene.input_ns = event->common.timestamp;
+                as.scheduler.invalidate();
             }
 
             break;
 
         case SDL_EVENT_WINDOW_RESIZED:
-            resize_event(as);
+            update_window_size(as);
+            as.scheduler.invalidate();
+            break;
+
+        case SDL_EVENT_WINDOW_EXPOSED:
+            as.scheduler.invalidate();
             break;
 
         case SDL_EVENT_MOUSE_BUTTON_DOWN:
@@ -469,6 +1070,16 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
 
         case SDL_EVENT_MOUSE_BUTTON_UP:
             break;
+
+        default:
+            if (event->type == as.recognition_event) {
+                as.scene.input_ns = event->common.timestamp;
+                as.scheduler.invalidate();
+            } else if (event->type == as.glyph_cache.ready_event) {
+                // the next frame uploads the new glyphs and draws the text waiting for them
+                as.scheduler.invalidate();
+            }
+            break;
     }
 
     return SDL_APP_CONTINUE;
@@ -480,7 +1091,98 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
 
     if (appstate) {
         AppState &as = *static_cast<AppState *>(appstate);
-        SDL_DestroyRenderer(as.renderer);
+
+        // startup tasks may still be using the model, the audio device or the assets
+        as.startup.finish();
+
+        // the record callback runs on the audio thread until the stream is gone
+        if (as.recording_stream) {
+            SDL_DestroyAudioStream(as.recording_stream);
+            as.recording_stream = nullptr;
+        }
+
+        if (as.threaded) {
+            // GL objects are deleted below, take the context back
+            as.render_thread.stop();
+            SDL_GL_MakeCurrent(as.window, as.gl_ctx);
+        }
+
+        // every thread that records zones has stopped or is about to
+        save_trace();
+
+        as.scheduler.count_skipped(SDL_GetTicksNS());
+
+        const FrameScheduler &fs = as.scheduler;
+        LOG("frames rendered: %d, skipped: %d, avg render CPU: %.3f ms, CPU saved: %.1f ms",
+            static_cast<int>(fs.frames_rendered),
+            static_cast<int>(fs.frames_skipped),
+            static_cast<double>(fs.avg_render_cpu_ns()) * 1e-6,
+            static_cast<double>(fs.cpu_ns_saved()) * 1e-6);
+
+        const LayoutCache &lc = as.font.layout_cache;
+        LOG("text layout cache: %d entries, %d bytes, hit rate %.1f%%, %d evictions",
+            static_cast<int>(lc.lru.size()),
+            static_cast<int>(lc.bytes),
+            static_cast<double>(lc.hit_rate()) * 100.0,
+            static_cast<int>(lc.evictions));
+
+        LOG("layer cache rebuilds: %d, frames served: %d",
+            static_cast<int>(as.layer_cache.rebuilds),
+            static_cast<int>(as.layer_cache.frames_served));
+
+        const Profiler &p = as.profiler;
+        LOG("frame interval mean: %.2f ms, p99: %.2f ms, GPU mean: %.2f ms, GPU saved: %.1f ms",
+            static_cast<double>(p.frame_interval.mean()),
+            static_cast<double>(p.frame_interval.percentile(0.99f)),
+            static_cast<double>(p.gpu.mean()),
+            static_cast<double>(p.gpu.mean()) * static_cast<double>(fs.frames_skipped));
+
+        LOG("%s: frame interval stddev: %.3f ms, input to swap mean: %.2f ms, p99: %.2f ms",
+            as.threaded ? "render thread" : "main thread",
+            static_cast<double>(p.frame_interval.stddev()),
+            static_cast<double>(p.input_latency.mean()),
+            static_cast<double>(p.input_latency.percentile(0.99f)));
+
+        LOG("text batch glyphs: %d, flushes: %d, %.0f glyphs/ms",
+            static_cast<int>(as.text_batch.glyphs),
+            static_cast<int>(as.text_batch.flushes),
+            static_cast<double>(as.text_batch.glyphs_per_ms()));
+
+        LOG("asset reads: %d zero copy, %d decompressed, %d loose files",
+            static_cast<int>(as.vfs.zero_copy_reads.load()),
+            static_cast<int>(as.vfs.decompressed_reads.load()),
+            static_cast<int>(as.vfs.loose_reads.load()));
+
+        const ShapeStats &ss = shape_stats();
+        LOG("shape buffers: %d, GPU bytes: %d, geometry cache hits: %d, misses: %d",
+            static_cast<int>(ss.buffers),
+            static_cast<int>(ss.bytes),
+            static_cast<int>(ss.cache_hits),
+            static_cast<int>(ss.cache_misses));
+
+        if (as.glyph_cache.ready()) {
+            // joins the worker, its counters are final after this
+            as.glyph_cache.shutdown();
+
+            const GlyphCache &gc = as.glyph_cache;
+            LOG("glyph cache: %d generated in %.1f ms, %d uploads, %d KiB, %d page evictions, hits: %d, misses: %d",
+                static_cast<int>(gc.generated),
+                static_cast<double>(gc.generate_ns) * 1e-6,
+                static_cast<int>(gc.uploads),
+                static_cast<int>(gc.upload_bytes / 1024),
+                static_cast<int>(gc.evictions),
+                static_cast<int>(gc.hits),
+                static_cast<int>(gc.misses));
+        }
+
+        // these belong to the context, which goes away with the window
+        as.profiler.gpu_timer.release();
+        as.quad_index.reset();
+
+        if (as.renderer) {
+            SDL_DestroyRenderer(as.renderer);
+        }
+
         SDL_DestroyWindow(as.window);
 
         SDL_CloseAudioDevice(as.audio_device);
@@ -498,83 +1200,87 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
 
 SDL_AppResult SDL_AppIterate(void *appstate) {
     AppState &as = *static_cast<AppState *>(appstate);
+    Headless &headless = as.headless;
 
-#ifndef __EMSCRIPTEN__
-    SDL_GL_MakeCurrent(as.window, as.gl_ctx);
-#endif
+    TRACE_ZONE("SDL_AppIterate");
 
-    as.shape_shader.shader->use();
+    // the model and audio finish loading while frames are drawn
+    if (!as.startup_logged && as.startup.done()) {
+        TRACE_ZONE("startup finish");
+        as.startup_logged = true;
 
-    if (!as.init) {
-        resize_event(as);
-        as.init = true;
+        if (!as.startup.finish()) {
+            return SDL_APP_FAILURE;
+        }
+
+        as.startup.log_tasks();
+        as.startup.log_critical_path(as.first_frame_task, "first frame");
+
+        if (!headless.opt.enabled) {
+            as.startup.log_critical_path(as.listening_task, "listening");
+        }
     }
 
-    glDisable(GL_DEPTH_TEST);
-    glClearColor(0.0, 0.0, 0.0, 1.0);
-    glClear(GL_COLOR_BUFFER_BIT);
+    if (headless.opt.enabled) {
+        as.scene.letter = headless.scripted_letter();
+        as.scene.hud_visible = headless.show_hud();
+    } else {
+        as.scene.letter = as.spoken_letter;
+    }
 
-    as.vao->use();
+    if (as.threaded) {
+        // the render thread animates on its own, it only needs to hear about changes
+        if (as.scheduler.dirty) {
+            as.scenes.back() = as.scene;
+            as.scenes.publish();
+            as.render_thread.wake();
+            as.scheduler.dirty = false;
+        }
 
-    draw_shape(as.shape_shader, as.draw_area_bg, true, false, false);
+        TRACE_ZONE("wait events");
+        SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+        return SDL_APP_CONTINUE;
+    }
 
-    as.font_shader.set_bg(FONT_BG);
-    as.font_shader.set_outline(FONT_OUTLINE);
-    as.font_shader.set_outline_factor(FONT_OUTLINE_FACTOR);
+    if (!as.scheduler.dirty && !animating(as, as.scene) && as.init) {
+#ifndef __EMSCRIPTEN__
+        // Returns early when an event arrives, it'll be dispatched before the next iteration.
+        TRACE_ZONE("wait events");
+        SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+#endif
+        return SDL_APP_CONTINUE;
+    }
 
-    const std::vector<glm::vec4> color{
-        Color::blue,
-        Color::orange,
-        Color::red,
-        Color::teal,
-        Color::green,
-        Color::yellow,
-        Color::purple,
-        Color::pink,
-        Color::brown,
-    };
+    uint64_t render_start = SDL_GetTicksNS();
 
-    for (size_t i = 0; i < 26; i++) {
-        if (as.spoken_letter == static_cast<char>('A' + i)) {
-            as.font_shader.set_font_width(FONT_WIDTH * 1.2);
-
-            // glowing color effect
-            uint64_t now = SDL_GetTicksNS();
-            double secs = static_cast<double>(SDL_NS_TO_SECONDS(now));
-            double frac = static_cast<double>(now % SDL_NS_PER_SECOND) * 1e-9;
-            double t = secs + frac;
-            double f = 0.75;
-            double lo = 0.5;
-            double hi = 1.0;
-            double a = (hi - lo) * 0.5;
-            double c = (hi + lo) * 0.5;
-
-            float k = static_cast<float>(c + a * std::sin(2 * M_PI * f * t));
-
-            glm::vec4 col = color[i % color.size()] * k;
-            col[3] = 1.f;  // alpha
-
-            as.font_shader.set_fg(col);
-        } else {
-            as.font_shader.set_font_width(FONT_WIDTH);
-            as.font_shader.set_fg(Color::transparent);
-        }
+#ifndef __EMSCRIPTEN__
+    SDL_GL_MakeCurrent(as.window, as.gl_ctx);
+#endif
 
-        std::string str;
-        str = 'A' + static_cast<char>(i);
+    if (headless.opt.enabled) {
+        headless.begin_frame();
+    }
 
-        auto [vertex_uv, index] = as.font.make_text_vertex(str, true);
-        as.letter->update_vertex(glm::value_ptr(vertex_uv[0]), sizeof(glm::vec4) * vertex_uv.size());
+    render_frame(as, as.scene);
+
+    as.scheduler.dirty = false;
+    as.scheduler.frame_rendered(render_start, SDL_GetTicksNS());
+
+    if (headless.opt.enabled) {
+        TRACE_ZONE("headless end_frame");
+        bool ok = headless.end_frame(render_start);
+
+        if (!headless.done()) {
+            return SDL_APP_CONTINUE;
+        }
 
-        BBox b = bbox(vertex_uv);
-        glm::vec2 center = (b.start + b.end) * 0.5f * FONT_WIDTH;
-        glm::vec2 trans = as.letter_center[i] - center;
-        as.font_shader.set_trans(trans);
+        as.bench.finish();
+        headless.report();
 
-        draw_vertex_buffer(as.font_shader.shader, as.letter, as.font.tex);
+        return ok && headless.golden_failed == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
     }
 
-    SDL_GL_SwapWindow(as.window);
+    present(as, as.scene);
 
     return SDL_APP_CONTINUE;
 }
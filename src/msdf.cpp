@@ -0,0 +1,400 @@
+#include "msdf.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace {
+// edge colors, a bit per channel
+constexpr uint8_t BLACK = 0;
+constexpr uint8_t RED = 1;
+constexpr uint8_t GREEN = 2;
+constexpr uint8_t BLUE = 4;
+constexpr uint8_t CYAN = GREEN | BLUE;
+constexpr uint8_t WHITE = RED | GREEN | BLUE;
+
+// sin(3), directions turning by more than this make a corner
+constexpr float CORNER_CROSS = 0.14112f;
+
+struct Edge {
+    OutlineEdge e;
+    uint8_t color = WHITE;
+
+    glm::vec2 point(float t) const {
+        if (!e.curve) {
+            return e.p0 + (e.p1 - e.p0) * t;
+        }
+
+        return e.p0 * ((1 - t) * (1 - t)) + e.c * (2 * t * (1 - t)) + e.p1 * (t * t);
+    }
+
+    glm::vec2 direction(float t) const {
+        if (!e.curve) {
+            return e.p1 - e.p0;
+        }
+
+        glm::vec2 d = (e.c - e.p0) * (1 - t) + (e.p1 - e.c) * t;
+
+        // a control point on an end point leaves no tangent there
+        if (d == glm::vec2{0.f}) {
+            return e.p1 - e.p0;
+        }
+
+        return d;
+    }
+};
+
+// Signed distance with the tie breaker msdfgen uses: at an equal distance the edge whose direction
+// is more orthogonal to the point wins, so a point near a corner picks the right edge.
+struct Distance {
+    float d = -1e30f;
+    float dot = 1.f;
+
+    bool operator<(const Distance &o) const {
+        return std::abs(d) < std::abs(o.d) || (std::abs(d) == std::abs(o.d) && dot < o.dot);
+    }
+};
+
+float cross(glm::vec2 a, glm::vec2 b) { return a.x * b.y - a.y * b.x; }
+
+float non_zero_sign(float v) { return v > 0.f ? 1.f : -1.f; }
+
+glm::vec2 unit(glm::vec2 v) {
+    float len = glm::length(v);
+    return len > 0.f ? v / len : glm::vec2{0.f, 1.f};
+}
+
+int solve_quadratic(double x[2], double a, double b, double c) {
+    if (a == 0 || std::abs(b) > 1e12 * std::abs(a)) {
+        if (b == 0) {
+            return 0;
+        }
+
+        x[0] = -c / b;
+        return 1;
+    }
+
+    double disc = b * b - 4 * a * c;
+
+    if (disc > 0) {
+        disc = std::sqrt(disc);
+        x[0] = (-b + disc) / (2 * a);
+        x[1] = (-b - disc) / (2 * a);
+        return 2;
+    }
+
+    if (disc == 0) {
+        x[0] = -b / (2 * a);
+        return 1;
+    }
+
+    return 0;
+}
+
+// x^3 + a x^2 + b x + c
+int solve_cubic_normed(double x[3], double a, double b, double c) {
+    double a2 = a * a;
+    double q = (a2 - 3 * b) / 9;
+    double r = (a * (2 * a2 - 9 * b) + 27 * c) / 54;
+    double r2 = r * r;
+    double q3 = q * q * q;
+
+    a /= 3;
+
+    if (r2 < q3) {
+        double t = std::acos(std::clamp(r / std::sqrt(q3), -1.0, 1.0));
+        q = -2 * std::sqrt(q);
+        x[0] = q * std::cos(t / 3) - a;
+        x[1] = q * std::cos((t + 2 * M_PI) / 3) - a;
+        x[2] = q * std::cos((t - 2 * M_PI) / 3) - a;
+        return 3;
+    }
+
+    double u = (r < 0 ? 1 : -1) * std::cbrt(std::abs(r) + std::sqrt(r2 - q3));
+    double v = u == 0 ? 0 : q / u;
+    x[0] = (u + v) - a;
+
+    if (u == v || std::abs(u - v) < 1e-12 * std::abs(u + v)) {
+        x[1] = -0.5 * (u + v) - a;
+        return 2;
+    }
+
+    return 1;
+}
+
+int solve_cubic(double x[3], double a, double b, double c, double d) {
+    if (a != 0 && std::abs(b / a) < 1e6) {
+        return solve_cubic_normed(x, b / a, c / a, d / a);
+    }
+
+    return solve_quadratic(x, b, c, d);
+}
+
+// Positive on the right of the edge direction, inside a clockwise contour.
+// param is where along the edge the nearest point is, outside [0, 1] past an end point.
+Distance signed_distance(const Edge &edge, glm::vec2 p, float &param) {
+    const OutlineEdge &e = edge.e;
+
+    if (!e.curve) {
+        glm::vec2 aq = p - e.p0;
+        glm::vec2 ab = e.p1 - e.p0;
+        param = glm::dot(aq, ab) / glm::dot(ab, ab);
+
+        glm::vec2 eq = (param > 0.5f ? e.p1 : e.p0) - p;
+        float end_distance = glm::length(eq);
+
+        if (param > 0.f && param < 1.f) {
+            float ortho = cross(aq, ab) / glm::length(ab);
+
+            if (std::abs(ortho) < end_distance) {
+                return {ortho, 0.f};
+            }
+        }
+
+        return {non_zero_sign(cross(aq, ab)) * end_distance, std::abs(glm::dot(unit(ab), unit(eq)))};
+    }
+
+    glm::vec2 qa = e.p0 - p;
+    glm::vec2 ab = e.c - e.p0;
+    glm::vec2 br = e.p1 - e.c - ab;
+
+    double a = glm::dot(br, br);
+    double b = 3.0 * glm::dot(ab, br);
+    double c = 2.0 * glm::dot(ab, ab) + glm::dot(qa, br);
+    double d = glm::dot(qa, ab);
+
+    double t[3];
+    int solutions = solve_cubic(t, a, b, c, d);
+
+    glm::vec2 dir0 = edge.direction(0);
+    float min_distance = non_zero_sign(cross(dir0, qa)) * glm::length(qa);
+    param = -glm::dot(qa, dir0) / glm::dot(dir0, dir0);
+
+    glm::vec2 dir1 = edge.direction(1);
+    float distance = glm::length(e.p1 - p);
+
+    if (distance < std::abs(min_distance)) {
+        min_distance = non_zero_sign(cross(dir1, e.p1 - p)) * distance;
+        param = glm::dot(p - e.c, dir1) / glm::dot(dir1, dir1);
+    }
+
+    for (int i = 0; i < solutions; i++) {
+        if (t[i] <= 0 || t[i] >= 1) {
+            continue;
+        }
+
+        float ti = static_cast<float>(t[i]);
+        glm::vec2 qe = qa + ab * (2 * ti) + br * (ti * ti);
+        distance = glm::length(qe);
+
+        if (distance <= std::abs(min_distance)) {
+            min_distance = non_zero_sign(cross(ab + br * ti, qe)) * distance;
+            param = ti;
+        }
+    }
+
+    if (param >= 0.f && param <= 1.f) {
+        return {min_distance, 0.f};
+    }
+
+    if (param < 0.5f) {
+        return {min_distance, std::abs(glm::dot(unit(dir0), unit(qa)))};
+    }
+
+    return {min_distance, std::abs(glm::dot(unit(dir1), unit(e.p1 - p)))};
+}
+
+// Past an end point the distance to the edge's tangent line, which keeps corners sharp.
+float pseudo_distance(const Edge &edge, glm::vec2 p, Distance dist, float param) {
+    if (param < 0.f) {
+        glm::vec2 dir = unit(edge.direction(0));
+        glm::vec2 aq = p - edge.e.p0;
+
+        if (glm::dot(aq, dir) < 0.f) {
+            float pseudo = cross(aq, dir);
+            if (std::abs(pseudo) <= std::abs(dist.d)) {
+                return pseudo;
+            }
+        }
+    } else if (param > 1.f) {
+        glm::vec2 dir = unit(edge.direction(1));
+        glm::vec2 bq = p - edge.e.p1;
+
+        if (glm::dot(bq, dir) > 0.f) {
+            float pseudo = cross(bq, dir);
+            if (std::abs(pseudo) <= std::abs(dist.d)) {
+                return pseudo;
+            }
+        }
+    }
+
+    return dist.d;
+}
+
+void split_in_thirds(std::vector<Edge> &edges) {
+    std::vector<Edge> split;
+
+    for (const Edge &edge : edges) {
+        glm::vec2 p[4] = {edge.e.p0, edge.point(1.f / 3), edge.point(2.f / 3), edge.e.p1};
+
+        for (int i = 0; i < 3; i++) {
+            Edge part;
+            part.e.p0 = p[i];
+            part.e.p1 = p[i + 1];
+            part.e.c = p[i];
+
+            if (edge.e.curve) {
+                // control point of the sub curve, the tangents at both ends meet there
+                float t0 = static_cast<float>(i) / 3;
+                part.e.c = p[i] + edge.direction(t0) * (1.f / 3);
+                part.e.curve = true;
+            }
+
+            split.push_back(part);
+        }
+    }
+
+    edges = std::move(split);
+}
+
+void switch_color(uint8_t &color, uint8_t banned = BLACK) {
+    uint8_t combined = static_cast<uint8_t>(color & banned);
+
+    if (combined == RED || combined == GREEN || combined == BLUE) {
+        color = static_cast<uint8_t>(combined ^ WHITE);
+        return;
+    }
+
+    if (color == BLACK || color == WHITE) {
+        color = CYAN;
+        return;
+    }
+
+    uint8_t shifted = static_cast<uint8_t>(color << 1);
+    color = static_cast<uint8_t>((shifted | shifted >> 3) & WHITE);
+}
+
+// msdfgen's edgeColoringSimple with a zero seed
+void color_edges(std::vector<Edge> &edges) {
+    size_t m = edges.size();
+    std::vector<size_t> corners;
+
+    glm::vec2 prev = unit(edges.back().direction(1));
+    for (size_t i = 0; i < m; i++) {
+        glm::vec2 dir = unit(edges[i].direction(0));
+
+        if (glm::dot(prev, dir) <= 0.f || std::abs(cross(prev, dir)) > CORNER_CROSS) {
+            corners.push_back(i);
+        }
+
+        prev = unit(edges[i].direction(1));
+    }
+
+    if (corners.empty()) {
+        return;
+    }
+
+    if (corners.size() == 1) {
+        // a teardrop, spread three colors around it so the corner still has two channels
+        if (m < 3) {
+            split_in_thirds(edges);
+            m = edges.size();
+            corners[0] *= 3;
+        }
+
+        uint8_t color = WHITE;
+        uint8_t colors[3];
+        switch_color(color);
+        colors[0] = color;
+        colors[1] = WHITE;
+        switch_color(color);
+        colors[2] = color;
+
+        for (size_t i = 0; i < m; i++) {
+            float f = 3.f + 2.875f * static_cast<float>(i) / static_cast<float>(m - 1) - 1.4375f + 0.5f;
+            edges[(corners[0] + i) % m].color = colors[static_cast<int>(f) - 3 + 1];
+        }
+
+        return;
+    }
+
+    size_t spline = 0;
+    size_t start = corners[0];
+    uint8_t color = WHITE;
+    switch_color(color);
+    uint8_t initial = color;
+
+    for (size_t i = 0; i < m; i++) {
+        size_t index = (start + i) % m;
+
+        if (spline + 1 < corners.size() && corners[spline + 1] == index) {
+            spline++;
+            switch_color(color, spline == corners.size() - 1 ? initial : BLACK);
+        }
+
+        edges[index].color = color;
+    }
+}
+
+uint8_t encode(float d, float range) {
+    float v = std::clamp(0.5f + d / range, 0.f, 1.f);
+    return static_cast<uint8_t>(std::lround(v * 255.f));
+}
+}  // namespace
+
+void generate_msdf(const GlyphOutline &outline,
+                   float scale,
+                   glm::vec2 translate,
+                   float range,
+                   int width,
+                   int height,
+                   uint8_t *rgb) {
+    std::vector<Edge> edges;
+    std::vector<Edge> contour;
+
+    for (const auto &c : outline.contours) {
+        contour.clear();
+
+        for (const OutlineEdge &e : c) {
+            contour.push_back(Edge{e, WHITE});
+        }
+
+        color_edges(contour);
+        edges.insert(edges.end(), contour.begin(), contour.end());
+    }
+
+    // range in font units
+    float shape_range = range / scale;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            glm::vec2 p = glm::vec2{static_cast<float>(x) + 0.5f, static_cast<float>(height - y) - 0.5f} / scale -
+                          translate;
+
+            Distance best[3];
+            const Edge *nearest[3] = {};
+            float param[3] = {};
+
+            for (const Edge &edge : edges) {
+                float t;
+                Distance d = signed_distance(edge, p, t);
+
+                for (int ch = 0; ch < 3; ch++) {
+                    if ((edge.color & (1 << ch)) && d < best[ch]) {
+                        best[ch] = d;
+                        nearest[ch] = &edge;
+                        param[ch] = t;
+                    }
+                }
+            }
+
+            uint8_t *out = rgb + (static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x)) * 3;
+
+            for (int ch = 0; ch < 3; ch++) {
+                float d = nearest[ch] ? pseudo_distance(*nearest[ch], p, best[ch], param[ch]) : -shape_range;
+                out[ch] = encode(d, shape_range);
+            }
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/vec2.hpp>
+
+#include "truetype.hpp"
+
+// Multi-channel signed distance field of a glyph outline in the format FontShader samples:
+// median(r, g, b) is 0.5 on the outline and rises inside, by 0.5 over range / 2 pixels.
+// Edges are colored and each channel takes the pseudo-distance to its nearest edge, following msdfgen's
+// simple edge coloring with a 3 radian corner threshold. There's no error correction pass.
+//
+// Pixel (x, y) samples the outline at ((x + 0.5, height - y - 0.5) / scale - translate), rows go top down.
+// scale is pixels per font unit, range is in pixels. Writes width * height * 3 bytes to rgb.
+void generate_msdf(const GlyphOutline &outline,
+                   float scale,
+                   glm::vec2 translate,
+                   float range,
+                   int width,
+                   int height,
+                   uint8_t *rgb);
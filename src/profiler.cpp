@@ -0,0 +1,192 @@
+#include "profiler.hpp"
+
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "log.hpp"
+
+float ns_to_ms(uint64_t ns) { return static_cast<float>(static_cast<double>(ns) * 1e-6); }
+
+void RollingHistogram::add(float ms) {
+    auto bin = [](float v) { return std::min(static_cast<size_t>(std::max(v, 0.f) / BIN_MS), BINS - 1); };
+
+    if (count == WINDOW) {
+        float old = window[next];
+        bins[bin(old)]--;
+        sum -= old;
+    } else {
+        count++;
+    }
+
+    window[next] = ms;
+    bins[bin(ms)]++;
+    sum += ms;
+
+    next = (next + 1) % WINDOW;
+}
+
+float RollingHistogram::last() const {
+    if (count == 0) {
+        return 0.f;
+    }
+
+    return window[(next + WINDOW - 1) % WINDOW];
+}
+
+float RollingHistogram::mean() const {
+    if (count == 0) {
+        return 0.f;
+    }
+
+    return static_cast<float>(sum / static_cast<double>(count));
+}
+
+float RollingHistogram::stddev() const {
+    if (count < 2) {
+        return 0.f;
+    }
+
+    double m = sum / static_cast<double>(count);
+    double sq = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        double d = static_cast<double>(window[i]) - m;
+        sq += d * d;
+    }
+
+    return static_cast<float>(std::sqrt(sq / static_cast<double>(count - 1)));
+}
+
+float RollingHistogram::percentile(float p) const {
+    if (count == 0) {
+        return 0.f;
+    }
+
+    size_t target = static_cast<size_t>(p * static_cast<float>(count - 1)) + 1;
+    size_t total = 0;
+
+    for (size_t i = 0; i < BINS; i++) {
+        total += bins[i];
+
+        if (total >= target) {
+            return static_cast<float>(i + 1) * BIN_MS;  // upper edge of the bin
+        }
+    }
+
+    return static_cast<float>(BINS) * BIN_MS;
+}
+
+void GpuTimer::init() {
+    supported = has_gl_extension("GL_EXT_disjoint_timer_query");
+
+    if (supported) {
+        glGenQueriesEXT(static_cast<GLsizei>(query.size()), query.data());
+    }
+
+    LOG("GPU timer queries: %s", supported ? "yes" : "no");
+}
+
+void GpuTimer::release() {
+    if (supported) {
+        glDeleteQueriesEXT(static_cast<GLsizei>(query.size()), query.data());
+        supported = false;
+    }
+}
+
+void GpuTimer::begin() {
+    // all queries in flight, skip this frame
+    if (!supported || pending[next]) {
+        return;
+    }
+
+    glBeginQueryEXT(GL_TIME_ELAPSED_EXT, query[next]);
+    active = true;
+}
+
+void GpuTimer::end() {
+    if (!active) {
+        return;
+    }
+
+    glEndQueryEXT(GL_TIME_ELAPSED_EXT);
+    pending[next] = true;
+    next = (next + 1) % query.size();
+    active = false;
+}
+
+bool GpuTimer::poll(float &ms) {
+    if (!supported) {
+        return false;
+    }
+
+    // oldest query in flight
+    size_t i = next;
+    for (size_t k = 0; k < query.size(); k++, i = (i + 1) % query.size()) {
+        if (pending[i]) {
+            break;
+        }
+    }
+
+    if (!pending[i]) {
+        return false;
+    }
+
+    GLint available = 0;
+    glGetQueryObjectivEXT(query[i], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+
+    if (!available) {
+        return false;
+    }
+
+    pending[i] = false;
+
+    // results are meaningless if the GPU was disjoint, e.g. a power state change
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+    if (disjoint) {
+        return false;
+    }
+
+    GLuint64 ns = 0;
+    glGetQueryObjectui64vEXT(query[i], GL_QUERY_RESULT_EXT, &ns);
+    ms = ns_to_ms(ns);
+
+    return true;
+}
+
+void Profiler::begin_frame() {
+    uint64_t now = SDL_GetTicksNS();
+
+    if (last_frame_ns != 0) {
+        frame_interval.add(ns_to_ms(now - last_frame_ns));
+    }
+
+    last_frame_ns = now;
+
+    float ms;
+    if (gpu_timer.poll(ms)) {
+        gpu.add(ms);
+    }
+
+    uint32_t seq = decode_seq.load();
+    if (seq != decode_seen) {
+        decode.add(ns_to_ms(decode_ns.load()));
+        decode_seen = seq;
+    }
+
+    gpu_timer.begin();
+}
+
+void Profiler::end_frame() { gpu_timer.end(); }
+
+void Profiler::add_decode_sample(uint64_t ns) {
+    decode_ns.store(ns);
+    decode_seq++;
+}
+
+ScopedTimer::ScopedTimer(RollingHistogram &h) : hist(h), start(SDL_GetTicksNS()) {}
+
+ScopedTimer::~ScopedTimer() { hist.add(ns_to_ms(SDL_GetTicksNS() - start)); }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "gl_helper.hpp"
+
+// Histogram over the last WINDOW samples, in milliseconds.
+// Samples beyond the last bin are counted in the last bin.
+struct RollingHistogram {
+    static constexpr size_t WINDOW = 256;
+    static constexpr size_t BINS = 1000;
+    static constexpr float BIN_MS = 0.1f;
+
+    std::array<float, WINDOW> window{};
+    std::array<uint16_t, BINS> bins{};
+    size_t count = 0;
+    size_t next = 0;
+    double sum = 0;
+
+    void add(float ms);
+
+    float last() const;
+    float mean() const;
+    float stddev() const;
+    float percentile(float p) const;  // p in [0, 1], resolution of BIN_MS
+};
+
+// Measures GPU time using EXT_disjoint_timer_query.
+// Results are read back a few frames later to avoid stalling the pipeline.
+struct GpuTimer {
+    static constexpr size_t QUERIES = 4;
+
+    bool supported = false;
+    std::array<GLuint, QUERIES> query{};
+    std::array<bool, QUERIES> pending{};
+    size_t next = 0;
+    bool active = false;
+
+    void init();
+    void release();
+
+    void begin();
+    void end();
+    bool poll(float &ms);  // true if a result was ready
+};
+
+// CPU sections of SDL_AppIterate
+enum class Stage { frame, update, cache, draw, hud, swap, count };
+
+struct Profiler {
+    std::array<RollingHistogram, static_cast<size_t>(Stage::count)> cpu;
+    RollingHistogram frame_interval;
+    RollingHistogram gpu;
+    RollingHistogram decode;  // one vosk decode call on a chunk of audio
+    RollingHistogram input_latency;  // input event to the swap that shows it
+
+    GpuTimer gpu_timer;
+    uint64_t last_frame_ns = 0;
+
+    // written by the audio thread
+    std::atomic<uint64_t> decode_ns = 0;
+    std::atomic<uint32_t> decode_seq = 0;
+    uint32_t decode_seen = 0;
+
+    RollingHistogram &stage(Stage s) { return cpu[static_cast<size_t>(s)]; }
+    const RollingHistogram &stage(Stage s) const { return cpu[static_cast<size_t>(s)]; }
+
+    void begin_frame();
+    void end_frame();
+
+    // thread safe
+    void add_decode_sample(uint64_t ns);
+};
+
+struct ScopedTimer {
+    RollingHistogram &hist;
+    uint64_t start;
+
+    explicit ScopedTimer(RollingHistogram &h);
+    ~ScopedTimer();
+};
+
+float ns_to_ms(uint64_t ns);
@@ -0,0 +1,65 @@
+#include "render_thread.hpp"
+
+#include "log.hpp"
+
+bool RenderThread::start(std::function<void()> f) {
+    body = std::move(f);
+
+    wake_sem = SDL_CreateSemaphore(0);
+
+    if (!wake_sem) {
+        LOG("can't create render thread semaphore: %s", SDL_GetError());
+        return false;
+    }
+
+    running = true;
+
+    auto entry = [](void *data) {
+        static_cast<RenderThread *>(data)->body();
+        return 0;
+    };
+
+    thread = SDL_CreateThread(entry, "render", this);
+
+    if (!thread) {
+        LOG("can't create render thread: %s", SDL_GetError());
+        running = false;
+        SDL_DestroySemaphore(wake_sem);
+        wake_sem = nullptr;
+        return false;
+    }
+
+    LOG("render thread started");
+
+    return true;
+}
+
+void RenderThread::stop() {
+    if (!thread) {
+        return;
+    }
+
+    running = false;
+    wake();
+    SDL_WaitThread(thread, nullptr);
+    thread = nullptr;
+
+    SDL_DestroySemaphore(wake_sem);
+    wake_sem = nullptr;
+
+    LOG("render thread stopped");
+}
+
+void RenderThread::wake() {
+    if (wake_sem) {
+        SDL_SignalSemaphore(wake_sem);
+    }
+}
+
+void RenderThread::wait() {
+    SDL_WaitSemaphore(wake_sem);
+
+    // one wake-up is enough for any number of publishes, the body reads the newest anyway
+    while (SDL_TryWaitSemaphore(wake_sem)) {
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_thread.h>
+
+#include <atomic>
+#include <functional>
+
+// Runs body on its own thread until stop() is called, body should loop while running is set.
+// The thread that owns the GL context has to release it before start(), body makes it current.
+struct RenderThread {
+    SDL_Thread *thread = nullptr;
+    SDL_Semaphore *wake_sem = nullptr;
+    std::atomic<bool> running = false;
+    std::function<void()> body;
+
+    bool start(std::function<void()> f);
+    void stop();
+
+    // Producer side, call after publishing something new. Wakes a body blocked in wait().
+    void wake();
+    // Body side, blocks until the next wake() or stop() instead of polling while there's nothing to draw.
+    void wait();
+};
@@ -0,0 +1,158 @@
+#include "shader_cache.hpp"
+
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_iostream.h>
+
+#include <cstring>
+#include <vector>
+
+#include "log.hpp"
+
+namespace {
+constexpr uint32_t CACHE_MAGIC = 0x42534241;  // "ABSB"
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t format;  // binary format returned by the driver
+    uint64_t key;
+    uint64_t compile_ns;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+bool enabled = false;
+std::string cache_dir;
+std::string driver;
+
+uint64_t fnv1a(const std::string &str, uint64_t hash = 0xcbf29ce484222325ull) {
+    for (unsigned char ch : str) {
+        hash ^= ch;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+std::string cache_path(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return cache_dir + name;
+}
+}  // namespace
+
+void init_shader_cache(const std::string &dir) {
+#ifdef __EMSCRIPTEN__
+    // WebGL doesn't expose program binaries
+    (void)dir;
+    return;
+#else
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+
+    if (formats <= 0) {
+        LOG("shader cache disabled: no program binary formats");
+        return;
+    }
+
+    if (!SDL_CreateDirectory(dir.c_str())) {
+        LOG("shader cache disabled: can't create %s", dir.c_str());
+        return;
+    }
+
+    auto str = [](GLenum name) {
+        const char *s = reinterpret_cast<const char *>(glGetString(name));
+        return std::string(s ? s : "");
+    };
+
+    driver = str(GL_VENDOR) + "\n" + str(GL_RENDERER) + "\n" + str(GL_VERSION);
+    cache_dir = dir;
+    enabled = true;
+
+    LOG("shader cache: %s", dir.c_str());
+#endif
+}
+
+uint64_t shader_cache_key(const std::string &vertex_code, const std::string &fragment_code) {
+    uint64_t hash = fnv1a(driver);
+    hash = fnv1a(vertex_code, hash);
+    hash = fnv1a("\n--\n", hash);
+    return fnv1a(fragment_code, hash);
+}
+
+bool load_program_binary(GLuint program, uint64_t key, uint64_t &compile_ns) {
+    if (!enabled) {
+        return false;
+    }
+
+    size_t size = 0;
+    uint8_t *data = static_cast<uint8_t *>(SDL_LoadFile(cache_path(key).c_str(), &size));
+
+    if (!data) {
+        return false;
+    }
+
+    CacheHeader h;
+    bool ok = size >= sizeof(h);
+
+    if (ok) {
+        memcpy(&h, data, sizeof(h));
+        ok = h.magic == CACHE_MAGIC && h.key == key && h.length == size - sizeof(h);
+    }
+
+    if (ok) {
+        glProgramBinaryOES(program, h.format, data + sizeof(h), static_cast<GLint>(h.length));
+
+        // the driver can reject a binary at any time, e.g. after an update
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        ok = status == GL_TRUE;
+    }
+
+    SDL_free(data);
+
+    if (!ok) {
+        LOG("shader cache: stale entry %016llx", static_cast<unsigned long long>(key));
+        return false;
+    }
+
+    compile_ns = h.compile_ns;
+
+    return true;
+}
+
+void save_program_binary(GLuint program, uint64_t key, uint64_t compile_ns) {
+    if (!enabled) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<uint8_t> data(sizeof(CacheHeader) + static_cast<size_t>(length));
+
+    CacheHeader h{};
+    h.magic = CACHE_MAGIC;
+    h.key = key;
+    h.compile_ns = compile_ns;
+
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinaryOES(program, length, &written, &format, data.data() + sizeof(h));
+
+    if (written <= 0) {
+        return;
+    }
+
+    h.format = format;
+    h.length = static_cast<uint32_t>(written);
+    memcpy(data.data(), &h, sizeof(h));
+
+    std::string path = cache_path(key);
+    if (!SDL_SaveFile(path.c_str(), data.data(), sizeof(h) + h.length)) {
+        LOG("shader cache: can't write %s", path.c_str());
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "gl_helper.hpp"
+
+// On-disk cache of linked program binaries (OES_get_program_binary).
+// Keyed by a hash of the shader source plus the driver vendor, renderer and version,
+// so a driver update invalidates old entries.
+// Call init_shader_cache once a GL context is current. The cache stays disabled otherwise.
+void init_shader_cache(const std::string &dir);
+
+uint64_t shader_cache_key(const std::string &vertex_code, const std::string &fragment_code);
+
+// compile_ns is how long the GL thread spent compiling and linking when the binary was saved, what a hit saves.
+bool load_program_binary(GLuint program, uint64_t key, uint64_t &compile_ns);
+void save_program_binary(GLuint program, uint64_t key, uint64_t compile_ns);
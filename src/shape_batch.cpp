@@ -0,0 +1,119 @@
+#include "shape_batch.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+// initial instance buffer capacity
+constexpr size_t MIN_INSTANCES = 256;
+
+constexpr GLuint TRANSFORM_LOC = 1;
+constexpr GLuint COLOR_LOC = 2;
+}  // namespace
+
+void ShapeBatch::add(Shape &shape, bool fill, bool line, bool line_highlight) {
+    glm::vec4 transform{shape.trans, shape.scale, shape.theta};
+
+    auto add_part = [&](ShapePart part) {
+        const ShapePrimitive &prim = shape_primitive(shape, part);
+        std::vector<Group> &groups = pass[static_cast<size_t>(part)];
+
+        // few distinct outlines per frame, a linear search beats hashing
+        auto it = std::find_if(
+            groups.begin(), groups.end(), [&](const Group &g) { return g.geometry == prim.vertex_buffer; });
+
+        if (it == groups.end()) {
+            groups.push_back(Group{prim.vertex_buffer, {}});
+            it = groups.end() - 1;
+        }
+
+        it->instance.push_back(Instance{transform, prim.color});
+    };
+
+    if (fill) {
+        add_part(ShapePart::fill);
+    }
+
+    if (line) {
+        add_part(ShapePart::line);
+    }
+
+    if (line_highlight) {
+        add_part(ShapePart::line_highlight);
+    }
+
+    shapes++;
+}
+
+void ShapeBatch::flush(const ShapeShader &shape_shader) {
+    upload.clear();
+
+    for (auto &groups : pass) {
+        // nothing was added to these since the last flush, drop their geometry reference
+        groups.erase(std::remove_if(groups.begin(), groups.end(), [](const Group &g) { return g.instance.empty(); }),
+                     groups.end());
+
+        for (const Group &g : groups) {
+            upload.insert(upload.end(), g.instance.begin(), g.instance.end());
+        }
+    }
+
+    if (upload.empty()) {
+        return;
+    }
+
+    if (!instances) {
+        instances = make_buffer(MIN_INSTANCES * sizeof(Instance));
+    }
+
+    // every group of the frame in one upload, each draw points the instance attributes at its range
+    instances->stream(upload.data(), upload.size() * sizeof(Instance));
+
+    const ShaderPtr &s = shape_shader.instanced_shader;
+    s->use();
+
+    size_t first = 0;
+
+    for (auto &groups : pass) {
+        for (Group &g : groups) {
+            // The instance attributes are set on the geometry's vertex array for this draw only and turned
+            // off after it, draw_shape uses the same vertex array without them.
+            g.geometry->use();
+            glBindBuffer(GL_ARRAY_BUFFER, instances->id);
+
+            size_t offset = first * sizeof(Instance);
+            GLsizei stride = sizeof(Instance);
+
+            glEnableVertexAttribArray(TRANSFORM_LOC);
+            glVertexAttribPointer(
+                TRANSFORM_LOC, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void *>(offset));
+            glVertexAttribDivisor(TRANSFORM_LOC, 1);
+
+            glEnableVertexAttribArray(COLOR_LOC);
+            glVertexAttribPointer(COLOR_LOC,
+                                  4,
+                                  GL_FLOAT,
+                                  GL_FALSE,
+                                  stride,
+                                  reinterpret_cast<const void *>(offset + offsetof(Instance, color)));
+            glVertexAttribDivisor(COLOR_LOC, 1);
+
+            glDrawElementsInstanced(GL_TRIANGLES,
+                                    static_cast<GLsizei>(g.geometry->index_count),
+                                    g.geometry->index_type,
+                                    0,
+                                    static_cast<GLsizei>(g.instance.size()));
+
+            glVertexAttribDivisor(TRANSFORM_LOC, 0);
+            glVertexAttribDivisor(COLOR_LOC, 0);
+            glDisableVertexAttribArray(TRANSFORM_LOC);
+            glDisableVertexAttribArray(COLOR_LOC);
+
+            first += g.instance.size();
+            g.instance.clear();
+            draws++;
+        }
+    }
+
+    flushes++;
+}
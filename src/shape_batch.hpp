@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "geometry.hpp"
+#include "gl_helper.hpp"
+
+// Collects shapes and draws all instances of one geometry with a single instanced draw call.
+// Transform and color are copied from the Shape's fields when it's added, so shapes sharing
+// an outline (see the geometry cache in draw_shape) cost one draw call however many there are.
+//
+// Fills are drawn first, then lines, then highlights. Within a pass geometries draw in the order
+// they were first added, so overlapping shapes of different outlines may not keep their add order.
+//
+// Usage per frame:
+//   batch.add(tile, true, true, false);
+//   batch.add(tile2, true, true, false);
+//   batch.flush(shape_shader);
+struct ShapeBatch {
+    struct Instance {
+        glm::vec4 transform;  // trans.xy, scale, theta
+        glm::vec4 color;
+    };
+
+    struct Group {
+        std::shared_ptr<VertexBuffer> geometry;
+        std::vector<Instance> instance;
+    };
+
+    // one list per ShapePart, groups are kept between frames so their vectors keep their capacity
+    std::array<std::vector<Group>, 3> pass;
+    std::vector<Instance> upload;
+    BufferPtr instances{{}, {}};
+
+    uint64_t shapes = 0;
+    uint64_t draws = 0;
+    uint64_t flushes = 0;
+
+    // Builds the shape's primitives on first use, needs the GL context.
+    void add(Shape &shape, bool fill, bool line, bool line_highlight);
+    void flush(const ShapeShader &shape_shader);
+};
@@ -0,0 +1,272 @@
+#include "task_graph.hpp"
+
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "log.hpp"
+#include "trace.hpp"
+
+size_t TaskGraph::add(const char *name,
+                      TaskThread thread,
+                      std::function<bool()> body,
+                      std::vector<size_t> deps) {
+    Task t;
+    t.name = name;
+    t.thread = thread;
+    t.body = std::move(body);
+    t.deps = std::move(deps);
+    tasks.push_back(std::move(t));
+
+    return tasks.size() - 1;
+}
+
+void TaskGraph::execute(size_t id) {
+    Task &t = tasks[id];
+    running++;
+
+    // the task is only touched by this thread until it's marked finished
+    SDL_UnlockMutex(lock);
+
+    t.start_ns = SDL_GetTicksNS();
+    {
+        TRACE_ZONE(t.name);
+        t.ok = t.body();
+    }
+    t.end_ns = SDL_GetTicksNS();
+
+    SDL_LockMutex(lock);
+
+    running--;
+    finished++;
+
+    if (t.thread == TaskThread::gl) {
+        gl_left--;
+    }
+
+    if (!t.ok) {
+        LOG("startup task %s failed", t.name);
+        failed = true;
+        worker_ready.clear();
+        gl_ready.clear();
+    } else if (!failed) {
+        for (size_t d : dependents[id]) {
+            if (--tasks[d].pending == 0) {
+                (tasks[d].thread == TaskThread::gl ? gl_ready : worker_ready).push_back(d);
+            }
+        }
+    }
+
+    SDL_BroadcastCondition(changed);
+}
+
+void TaskGraph::worker_loop() {
+    TRACE_THREAD("startup");
+    SDL_LockMutex(lock);
+
+    while (!stop) {
+        if (!worker_ready.empty()) {
+            size_t id = worker_ready.front();
+            worker_ready.pop_front();
+            execute(id);
+        } else {
+            SDL_WaitCondition(changed, lock);
+        }
+    }
+
+    SDL_UnlockMutex(lock);
+}
+
+bool TaskGraph::run() {
+    for (size_t i = 0; i < tasks.size(); i++) {
+        for (size_t d : tasks[i].deps) {
+            if (d >= i) {
+                LOG("startup task %s depends on a later task", tasks[i].name);
+                return false;
+            }
+        }
+    }
+
+    run_start_ns = SDL_GetTicksNS();
+
+    lock = SDL_CreateMutex();
+    changed = SDL_CreateCondition();
+
+    if (!lock || !changed) {
+        LOG("can't create task graph lock: %s", SDL_GetError());
+        SDL_DestroyCondition(changed);
+        SDL_DestroyMutex(lock);
+        changed = nullptr;
+        lock = nullptr;
+        return false;
+    }
+
+    dependents.assign(tasks.size(), {});
+
+    for (size_t i = 0; i < tasks.size(); i++) {
+        Task &t = tasks[i];
+        t.pending = t.deps.size();
+
+        for (size_t d : t.deps) {
+            dependents[d].push_back(i);
+        }
+
+        if (t.thread == TaskThread::gl) {
+            gl_left++;
+        }
+
+        if (t.pending == 0) {
+            (t.thread == TaskThread::gl ? gl_ready : worker_ready).push_back(i);
+        }
+    }
+
+#ifdef __EMSCRIPTEN__
+    int thread_count = 0;
+#else
+    int thread_count = workers;
+#endif
+
+    for (int i = 0; i < thread_count; i++) {
+        auto entry = [](void *data) {
+            static_cast<TaskGraph *>(data)->worker_loop();
+            return 0;
+        };
+
+        SDL_Thread *thread = SDL_CreateThread(entry, "startup", this);
+
+        if (!thread) {
+            // whatever threads there are still run everything, with none the calling thread does
+            LOG("can't create startup thread: %s", SDL_GetError());
+            break;
+        }
+
+        threads.push_back(thread);
+    }
+
+    SDL_LockMutex(lock);
+
+    while (!failed && (gl_left > 0 || (threads.empty() && !all_done()))) {
+        if (!gl_ready.empty()) {
+            size_t id = gl_ready.front();
+            gl_ready.pop_front();
+            execute(id);
+        } else if (threads.empty() && !worker_ready.empty()) {
+            size_t id = worker_ready.front();
+            worker_ready.pop_front();
+            execute(id);
+        } else {
+            SDL_WaitCondition(changed, lock);
+        }
+    }
+
+    bool ok = !failed;
+    SDL_UnlockMutex(lock);
+
+    return ok;
+}
+
+bool TaskGraph::done() {
+    if (!lock) {
+        return true;
+    }
+
+    SDL_LockMutex(lock);
+    bool d = all_done();
+    SDL_UnlockMutex(lock);
+
+    return d;
+}
+
+bool TaskGraph::finish() {
+    if (!lock) {
+        return !failed;
+    }
+
+    SDL_LockMutex(lock);
+
+    while (!all_done()) {
+        SDL_WaitCondition(changed, lock);
+    }
+
+    stop = true;
+    SDL_BroadcastCondition(changed);
+    SDL_UnlockMutex(lock);
+
+    for (SDL_Thread *thread : threads) {
+        SDL_WaitThread(thread, nullptr);
+    }
+
+    threads.clear();
+
+    SDL_DestroyCondition(changed);
+    SDL_DestroyMutex(lock);
+    changed = nullptr;
+    lock = nullptr;
+
+    return !failed;
+}
+
+void TaskGraph::log_tasks() const {
+    uint64_t busy_ns = 0;
+    uint64_t last_ns = run_start_ns;
+
+    for (const Task &t : tasks) {
+        if (t.end_ns == 0) {
+            LOG("startup task %-12s not run", t.name);
+            continue;
+        }
+
+        busy_ns += t.end_ns - t.start_ns;
+        last_ns = std::max(last_ns, t.end_ns);
+
+        LOG("startup task %-12s %-6s %7.2f ms, done at %7.2f ms",
+            t.name,
+            t.thread == TaskThread::gl ? "gl" : "worker",
+            static_cast<double>(t.end_ns - t.start_ns) * 1e-6,
+            static_cast<double>(t.end_ns - run_start_ns) * 1e-6);
+    }
+
+    LOG("startup: %.2f ms of work done in %.2f ms",
+        static_cast<double>(busy_ns) * 1e-6,
+        static_cast<double>(last_ns - run_start_ns) * 1e-6);
+}
+
+void TaskGraph::log_critical_path(size_t id, const char *what) const {
+    if (id >= tasks.size() || tasks[id].end_ns == 0) {
+        return;
+    }
+
+    // walk back through whichever dependency finished last, that's what each task waited for
+    std::vector<size_t> path{id};
+
+    while (!tasks[path.back()].deps.empty()) {
+        const std::vector<size_t> &deps = tasks[path.back()].deps;
+        size_t latest = deps[0];
+
+        for (size_t d : deps) {
+            if (tasks[d].end_ns > tasks[latest].end_ns) {
+                latest = d;
+            }
+        }
+
+        path.push_back(latest);
+    }
+
+    std::string chain;
+
+    for (size_t i = path.size(); i-- > 0;) {
+        const Task &t = tasks[path[i]];
+        char step[96];
+        snprintf(step,
+                 sizeof(step),
+                 "%s%s %.1f",
+                 chain.empty() ? "" : " > ",
+                 t.name,
+                 static_cast<double>(t.end_ns - t.start_ns) * 1e-6);
+        chain += step;
+    }
+
+    LOG("%s critical path (ms): %s", what, chain.c_str());
+}
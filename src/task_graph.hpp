@@ -0,0 +1,81 @@
+#pragma once
+
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_thread.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Where a task may run. GL tasks need the context, so they run on the thread that calls TaskGraph::run.
+enum class TaskThread { worker, gl };
+
+// Startup work as a dependency graph, each task starts as soon as the tasks it depends on are done.
+// Worker tasks share a small pool of threads, GL tasks run on the calling thread in between waiting.
+// Tasks can only depend on tasks added before them, so the graph can't have cycles.
+//
+// run() returns once the GL tasks are done, worker tasks none of them waited for may still be running
+// and finish() joins them. The first task that fails stops the rest from starting.
+// Without threads (Emscripten, workers = 0) run() does everything on the calling thread.
+struct TaskGraph {
+    struct Task {
+        const char *name = "";  // a literal, also the trace zone name
+        TaskThread thread = TaskThread::worker;
+        std::function<bool()> body;
+        std::vector<size_t> deps;
+
+        // set by run()
+        size_t pending = 0;  // deps not done yet
+        uint64_t start_ns = 0;
+        uint64_t end_ns = 0;
+        bool ok = false;
+    };
+
+    std::vector<Task> tasks;
+    int workers = 2;
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph &) = delete;
+    TaskGraph &operator=(const TaskGraph &) = delete;
+    ~TaskGraph() { finish(); }
+
+    // Returns the task's id for the deps of later tasks.
+    size_t add(const char *name, TaskThread thread, std::function<bool()> body, std::vector<size_t> deps = {});
+
+    // False if a task failed, call finish() before freeing what the running ones use.
+    bool run();
+    // True once every task is done or stopped, doesn't block.
+    bool done();
+    // Waits for the worker tasks and joins the pool, false if any task failed.
+    bool finish();
+
+    // Logs how long each task took and where it ran.
+    void log_tasks() const;
+    // Logs the chain of dependencies that ended last before task id, the one that decided when it ran.
+    void log_critical_path(size_t id, const char *what) const;
+
+    uint64_t end_ns(size_t id) const { return tasks[id].end_ns; }
+
+private:
+    std::vector<SDL_Thread *> threads;
+
+    // guarded by lock
+    SDL_Mutex *lock = nullptr;
+    SDL_Condition *changed = nullptr;
+    std::deque<size_t> worker_ready;
+    std::deque<size_t> gl_ready;
+    std::vector<std::vector<size_t>> dependents;
+    size_t finished = 0;
+    size_t running = 0;
+    size_t gl_left = 0;
+    bool failed = false;
+    bool stop = false;
+
+    uint64_t run_start_ns = 0;
+
+    bool all_done() const { return finished == tasks.size() || (failed && running == 0); }
+    void execute(size_t id);  // called with lock held, returns with it held
+    void worker_loop();
+};
@@ -0,0 +1,419 @@
+#include "tessellate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace {
+float cross(const glm::vec2 &a, const glm::vec2 &b) { return a.x * b.y - a.y * b.x; }
+
+// fraction of a cell the grid searches of fill_polygon add on each side, covers rounding at cell edges
+constexpr float CELL_SLACK = 0.01f;
+
+// Widens [x0, x1] by the x range of the part of segment p q with y0 <= y <= y1.
+void edge_span(const glm::vec2 &p, const glm::vec2 &q, float y0, float y1, float &x0, float &x1) {
+    float ya = std::max(std::min(p.y, q.y), y0);
+    float yb = std::min(std::max(p.y, q.y), y1);
+
+    if (ya > yb) {
+        return;
+    }
+
+    if (p.y == q.y) {
+        x0 = std::min({x0, p.x, q.x});
+        x1 = std::max({x1, p.x, q.x});
+        return;
+    }
+
+    float dxdy = (q.x - p.x) / (q.y - p.y);
+    float xa = p.x + (ya - p.y) * dxdy;
+    float xb = p.x + (yb - p.y) * dxdy;
+
+    x0 = std::min({x0, xa, xb});
+    x1 = std::max({x1, xa, xb});
+}
+
+glm::vec2 left_normal(const glm::vec2 &d) { return {-d.y, d.x}; }
+
+glm::vec2 rotate(const glm::vec2 &v, float theta) {
+    float c = std::cos(theta);
+    float s = std::sin(theta);
+    return {c * v.x - s * v.y, s * v.x + c * v.y};
+}
+
+uint32_t push_vertex(TessArena &arena, const glm::vec2 &v) {
+    arena.vertex.push_back(v);
+    return static_cast<uint32_t>(arena.vertex.size() - 1);
+}
+
+void push_triangle(TessArena &arena, uint32_t a, uint32_t b, uint32_t c) {
+    arena.index.push_back(a);
+    arena.index.push_back(b);
+    arena.index.push_back(c);
+}
+
+// Fills the outside of the corner at p, the inside is covered by the overlapping segment quads.
+void stroke_join(TessArena &arena,
+                 const glm::vec2 &prev,
+                 const glm::vec2 &p,
+                 const glm::vec2 &next,
+                 float hw,
+                 const StrokeStyle &style) {
+    glm::vec2 d0 = glm::normalize(p - prev);
+    glm::vec2 d1 = glm::normalize(next - p);
+    float turn = cross(d0, d1);
+    float cos_turn = std::clamp(glm::dot(d0, d1), -1.f, 1.f);
+
+    // straight through
+    if (std::abs(turn) < 1e-6f && cos_turn > 0.f) {
+        return;
+    }
+
+    // a left turn has its outer side on the right
+    float side = turn > 0.f ? -1.f : 1.f;
+    glm::vec2 n0 = left_normal(d0) * side;
+    glm::vec2 n1 = left_normal(d1) * side;
+
+    uint32_t center = push_vertex(arena, p);
+    uint32_t a = push_vertex(arena, p + n0 * hw);
+
+    LineJoin join = style.join;
+
+    if (join == LineJoin::miter) {
+        glm::vec2 bisector = n0 + n1;
+        float len = glm::length(bisector);
+
+        // miter length over half width is 1 / cos(half angle between the normals)
+        float ratio = len > 1e-6f ? 1.f / glm::dot(bisector / len, n0) : style.miter_limit + 1.f;
+
+        if (ratio <= style.miter_limit) {
+            uint32_t tip = push_vertex(arena, p + bisector / len * hw * ratio);
+            uint32_t b = push_vertex(arena, p + n1 * hw);
+            push_triangle(arena, center, a, tip);
+            push_triangle(arena, center, tip, b);
+            return;
+        }
+
+        join = LineJoin::bevel;
+    }
+
+    if (join == LineJoin::round) {
+        float angle = std::acos(cos_turn);
+        int segments = std::max(1, static_cast<int>(std::ceil(angle / style.round_step)));
+        float step = -side * angle / static_cast<float>(segments);
+
+        uint32_t last = a;
+        for (int i = 1; i <= segments; i++) {
+            uint32_t v = push_vertex(arena, p + rotate(n0 * hw, step * static_cast<float>(i)));
+            push_triangle(arena, center, last, v);
+            last = v;
+        }
+
+        return;
+    }
+
+    uint32_t b = push_vertex(arena, p + n1 * hw);
+    push_triangle(arena, center, a, b);
+}
+}  // namespace
+
+TessRange stroke_polyline(TessArena &arena, const glm::vec2 *pts, size_t count, const StrokeStyle &style) {
+    TessRange range;
+    range.first_vertex = static_cast<uint32_t>(arena.vertex.size());
+    range.first_index = static_cast<uint32_t>(arena.index.size());
+
+    // zero length segments have no direction
+    std::vector<uint32_t> &kept = arena.work;
+    kept.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        if (kept.empty() || pts[i] != pts[kept.back()]) {
+            kept.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    if (style.closed && kept.size() > 1 && pts[kept.front()] == pts[kept.back()]) {
+        kept.pop_back();
+    }
+
+    size_t n = kept.size();
+
+    if (n < 2) {
+        return range;
+    }
+
+    float hw = style.width * 0.5f;
+    size_t segments = style.closed ? n : n - 1;
+
+    auto point = [&](size_t i) { return pts[kept[i % n]]; };
+
+    for (size_t i = 0; i < segments; i++) {
+        glm::vec2 p0 = point(i);
+        glm::vec2 p1 = point(i + 1);
+        glm::vec2 offset = left_normal(glm::normalize(p1 - p0)) * hw;
+
+        uint32_t idx = static_cast<uint32_t>(arena.vertex.size());
+
+        arena.vertex.push_back(p0 + offset);
+        arena.vertex.push_back(p1 + offset);
+        arena.vertex.push_back(p1 - offset);
+        arena.vertex.push_back(p0 - offset);
+
+        push_triangle(arena, idx + 0, idx + 1, idx + 2);
+        push_triangle(arena, idx + 0, idx + 2, idx + 3);
+    }
+
+    size_t first_join = style.closed ? 0 : 1;
+    size_t last_join = style.closed ? n : n - 1;
+
+    for (size_t i = first_join; i < last_join; i++) {
+        stroke_join(arena, point(i + n - 1), point(i), point(i + 1), hw, style);
+    }
+
+    range.vertex_count = static_cast<uint32_t>(arena.vertex.size()) - range.first_vertex;
+    range.index_count = static_cast<uint32_t>(arena.index.size()) - range.first_index;
+
+    return range;
+}
+
+TessRange fill_polygon(TessArena &arena, const glm::vec2 *pts, size_t count) {
+    TessRange range;
+    range.first_vertex = static_cast<uint32_t>(arena.vertex.size());
+    range.first_index = static_cast<uint32_t>(arena.index.size());
+
+    uint32_t base = range.first_vertex;
+
+    for (size_t i = 0; i < count; i++) {
+        if (arena.vertex.size() == base || pts[i] != arena.vertex.back()) {
+            arena.vertex.push_back(pts[i]);
+        }
+    }
+
+    if (arena.vertex.size() - base > 1 && arena.vertex.back() == arena.vertex[base]) {
+        arena.vertex.pop_back();
+    }
+
+    uint32_t n = static_cast<uint32_t>(arena.vertex.size()) - base;
+    range.vertex_count = n;
+
+    if (n < 3) {
+        return range;
+    }
+
+    const glm::vec2 *v = &arena.vertex[base];
+
+    // shoelace, the sign gives the winding
+    float area = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        area += cross(v[i], v[(i + 1) % n]);
+    }
+
+    float winding = area < 0.f ? -1.f : 1.f;
+
+    // circular list of remaining vertices, prev / next per vertex
+    std::vector<uint32_t> &link = arena.link;
+    link.resize(n * 2);
+
+    for (uint32_t i = 0; i < n; i++) {
+        link[i * 2] = (i + n - 1) % n;
+        link[i * 2 + 1] = (i + 1) % n;
+    }
+
+    auto prev = [&](uint32_t i) { return link[i * 2]; };
+    auto next = [&](uint32_t i) { return link[i * 2 + 1]; };
+
+    auto convex = [&](uint32_t i) {
+        const glm::vec2 &a = v[prev(i)];
+        const glm::vec2 &b = v[i];
+        const glm::vec2 &c = v[next(i)];
+        return cross(b - a, c - b) * winding > 0.f;
+    };
+
+    // only reflex vertices can be inside an ear, a clipped ear never makes a vertex reflex.
+    // Nonzero for reflex vertices, once they're in the grid it's their position there + 1.
+    std::vector<uint32_t> &reflex = arena.work;
+    reflex.assign(n, 0);
+
+    uint32_t reflex_count = 0;
+    glm::vec2 lo = v[0];
+    glm::vec2 hi = v[0];
+
+    for (uint32_t i = 0; i < n; i++) {
+        reflex[i] = !convex(i);
+        reflex_count += reflex[i];
+        lo = glm::vec2{std::min(lo.x, v[i].x), std::min(lo.y, v[i].y)};
+        hi = glm::vec2{std::max(hi.x, v[i].x), std::max(hi.y, v[i].y)};
+    }
+
+    // grid of about one reflex vertex per cell, cell holds the start offsets, the end offsets, then the vertex ids.
+    // Vertices leave their cell when they're clipped or turn convex, so the cells only ever hold reflex ones.
+    uint32_t grid = std::max(1u, static_cast<uint32_t>(std::sqrt(static_cast<float>(reflex_count))));
+    uint32_t cells = grid * grid;
+    glm::vec2 extent = hi - lo;
+    glm::vec2 inv_size{extent.x > 0.f ? static_cast<float>(grid) / extent.x : 0.f,
+                       extent.y > 0.f ? static_cast<float>(grid) / extent.y : 0.f};
+
+    auto cell_xy = [&](const glm::vec2 &p, uint32_t &cx, uint32_t &cy) {
+        cx = std::min(grid - 1, static_cast<uint32_t>(std::max(0.f, (p.x - lo.x) * inv_size.x)));
+        cy = std::min(grid - 1, static_cast<uint32_t>(std::max(0.f, (p.y - lo.y) * inv_size.y)));
+    };
+
+    std::vector<uint32_t> &cell = arena.cell;
+    cell.assign(cells * 2 + 1 + reflex_count, 0);
+
+    uint32_t *cell_end = &cell[cells + 1];
+    uint32_t *cell_ids = cell_end + cells;
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (reflex[i]) {
+            uint32_t cx, cy;
+            cell_xy(v[i], cx, cy);
+            cell[cy * grid + cx + 1]++;
+        }
+    }
+
+    for (uint32_t c = 0; c < cells; c++) {
+        cell[c + 1] += cell[c];
+    }
+
+    // counting sort, uses the next cell's start as the running write position
+    for (uint32_t i = 0; i < n; i++) {
+        if (reflex[i]) {
+            uint32_t cx, cy;
+            cell_xy(v[i], cx, cy);
+            uint32_t k = cell[cy * grid + cx]++;
+            cell_ids[k] = i;
+            reflex[i] = k + 1;
+        }
+    }
+
+    // the write positions are now the ends, shift back to the starts
+    for (uint32_t c = cells; c > 0; c--) {
+        cell_end[c - 1] = cell[c - 1];
+        cell[c] = cell[c - 1];
+    }
+    cell[0] = 0;
+
+    // swaps the last vertex of the cell into the hole
+    auto remove_reflex = [&](uint32_t i) {
+        if (!reflex[i]) {
+            return;
+        }
+
+        uint32_t cx, cy;
+        cell_xy(v[i], cx, cy);
+
+        uint32_t k = reflex[i] - 1;
+        uint32_t last = cell_ids[--cell_end[cy * grid + cx]];
+        cell_ids[k] = last;
+        reflex[last] = k + 1;
+        reflex[i] = 0;
+        reflex_count--;
+    };
+
+    auto inside = [&](const glm::vec2 &p, const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &c) {
+        return cross(b - a, p - a) * winding >= 0.f && cross(c - b, p - b) * winding >= 0.f &&
+               cross(a - c, p - c) * winding >= 0.f;
+    };
+
+    auto is_ear = [&](uint32_t i) {
+        if (reflex[i]) {
+            return false;
+        }
+
+        // once the rest is convex every convex vertex is an ear
+        if (reflex_count == 0) {
+            return true;
+        }
+
+        uint32_t ia = prev(i);
+        uint32_t ic = next(i);
+        const glm::vec2 &a = v[ia];
+        const glm::vec2 &b = v[i];
+        const glm::vec2 &c = v[ic];
+
+        glm::vec2 tri_lo{std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y})};
+        glm::vec2 tri_hi{std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y})};
+
+        uint32_t x0, y0, x1, y1;
+        cell_xy(tri_lo, x0, y0);
+        cell_xy(tri_hi, x1, y1);
+
+        for (uint32_t cy = y0; cy <= y1; cy++) {
+            // a long sliver's box covers far more cells than the sliver, only visit the ones its row overlaps
+            if (y0 != y1) {
+                float row_lo = std::max(tri_lo.y, lo.y + (static_cast<float>(cy) - CELL_SLACK) / inv_size.y);
+                float row_hi = std::min(tri_hi.y, lo.y + (static_cast<float>(cy + 1) + CELL_SLACK) / inv_size.y);
+                float span_lo = tri_hi.x;
+                float span_hi = tri_lo.x;
+
+                edge_span(a, b, row_lo, row_hi, span_lo, span_hi);
+                edge_span(b, c, row_lo, row_hi, span_lo, span_hi);
+                edge_span(c, a, row_lo, row_hi, span_lo, span_hi);
+
+                float slack = inv_size.x > 0.f ? CELL_SLACK / inv_size.x : 0.f;
+                uint32_t unused;
+                cell_xy(glm::vec2{span_lo - slack, row_lo}, x0, unused);
+                cell_xy(glm::vec2{span_hi + slack, row_lo}, x1, unused);
+            }
+
+            for (uint32_t cx = x0; cx <= x1; cx++) {
+                uint32_t id = cy * grid + cx;
+
+                for (uint32_t k = cell[id]; k < cell_end[id]; k++) {
+                    uint32_t j = cell_ids[k];
+
+                    if (j == ia || j == ic) {
+                        continue;
+                    }
+
+                    if (v[j] != a && v[j] != b && v[j] != c && inside(v[j], a, b, c)) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    };
+
+    uint32_t remaining = n;
+    uint32_t cur = 0;
+    uint32_t misses = 0;
+
+    while (remaining > 3) {
+        // self intersecting input can run out of ears, clip anyway rather than loop forever
+        if (is_ear(cur) || misses > remaining) {
+            uint32_t p = prev(cur);
+            uint32_t q = next(cur);
+
+            push_triangle(arena, base + p, base + cur, base + q);
+
+            link[p * 2 + 1] = q;
+            link[q * 2] = p;
+            remove_reflex(cur);
+            remaining--;
+            misses = 0;
+
+            if (reflex[p] && convex(p)) {
+                remove_reflex(p);
+            }
+
+            if (reflex[q] && convex(q)) {
+                remove_reflex(q);
+            }
+
+            // moving on instead of retrying p keeps the ears small, retrying p builds a fan of slivers
+            cur = q;
+        } else {
+            cur = next(cur);
+            misses++;
+        }
+    }
+
+    push_triangle(arena, base + prev(cur), base + cur, base + next(cur));
+
+    range.index_count = static_cast<uint32_t>(arena.index.size()) - range.first_index;
+
+    return range;
+}
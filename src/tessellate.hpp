@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <vector>
+
+// Triangulation of polygons and polylines into GL_TRIANGLES.
+// Output is appended to a caller owned arena. clear() keeps the capacity, so a reused arena
+// stops allocating once it has grown to the largest shape.
+
+struct TessArena {
+    std::vector<glm::vec2> vertex;
+    std::vector<uint32_t> index;
+
+    // scratch space for the algorithms, contents are undefined between calls
+    std::vector<uint32_t> work;
+    std::vector<uint32_t> link;
+    std::vector<uint32_t> cell;
+
+    void clear() {
+        vertex.clear();
+        index.clear();
+    }
+};
+
+// The part of the arena written by one call.
+struct TessRange {
+    uint32_t first_vertex = 0;
+    uint32_t vertex_count = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+};
+
+enum class LineJoin { miter, bevel, round };
+
+struct StrokeStyle {
+    float width = 1.f;
+    LineJoin join = LineJoin::miter;
+    float miter_limit = 4.f;  // miter length / half width, longer miters fall back to bevel
+    float round_step = 0.3f;  // max angle in radians per round join segment
+    bool closed = true;
+};
+
+// O(n) in the number of points. Consecutive duplicate points are skipped, open strokes get butt caps.
+TessRange stroke_polyline(TessArena &arena, const glm::vec2 *pts, size_t count, const StrokeStyle &style);
+
+// Ear clipping, handles concave simple polygons in either winding.
+// Only reflex vertices can block an ear, they're bucketed in a uniform grid so each candidate ear
+// tests the ones in the cells it crosses, and none once the rest of the polygon is convex.
+// Close to linear for typical shapes. Ears that span the whole shape, like the spikes of a star,
+// cross O(sqrt(n)) cells each. O(n^2) worst case.
+TessRange fill_polygon(TessArena &arena, const glm::vec2 *pts, size_t count);
@@ -0,0 +1,142 @@
+#include "text_batch.hpp"
+
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+
+#include "log.hpp"
+
+namespace {
+// initial capacity, grows by powers of 2
+constexpr size_t MIN_QUADS = 256;
+
+// characters the atlas can't draw by itself, UTF-8 sequences or ones it lacks
+bool atlas_misses(const GlyphTable &table, const std::string &str) {
+    return std::any_of(str.begin(), str.end(), [&](char c) {
+        auto b = static_cast<unsigned char>(c);
+        return b >= 0x80 || !table.contains(b);
+    });
+}
+
+VertexBufferPtr make_stream_buffer(QuadIndex &quad_index, size_t quads) {
+    return make_quad_vertex_buffer(quad_index, nullptr, quads * 4 * sizeof(LetterVertex), quads, LAYOUT_POS_UV_LETTER);
+}
+}  // namespace
+
+void TextBatch::add(FontAtlas &font, const std::string &str, const glm::vec2 &pos, float size, int slot) {
+    uint64_t start = SDL_GetTicksNS();
+
+    scratch.clear();
+    size_t quads = 0;
+
+    if (glyph_cache && glyph_cache->ready() && atlas_misses(font.glyphs, str)) {
+        for (auto &v : page_scratch) {
+            v.clear();
+        }
+
+        glyph_cache->layout(str, font.glyphs, 1.f / static_cast<float>(font.grid_width), scratch, page_scratch);
+
+        if (page_vertex.size() < page_scratch.size()) {
+            page_vertex.resize(page_scratch.size());
+        }
+
+        for (size_t p = 0; p < page_scratch.size(); p++) {
+            for (const auto &v : page_scratch[p]) {
+                page_vertex[p].push_back(make_letter_vertex(v, pos, slot, size));
+            }
+
+            quads += page_scratch[p].size() / 4;
+        }
+    } else {
+        font.layout_text(str, true, scratch);
+    }
+
+    for (const auto &v : scratch) {
+        vertex.push_back(make_letter_vertex(v, pos, slot, size));
+    }
+
+    glyphs += quads + scratch.size() / 4;
+    cpu_ns += SDL_GetTicksNS() - start;
+}
+
+void TextBatch::flush(FontShader &font_shader, const FontAtlas &font, QuadIndex &quad_index) {
+    uint64_t start = SDL_GetTicksNS();
+
+    // atlas glyphs first, then each cache page's, one draw each
+    size_t atlas_quads = vertex.size() / 4;
+
+    for (std::vector<LetterVertex> &v : page_vertex) {
+        vertex.insert(vertex.end(), v.begin(), v.end());
+    }
+
+    if (vertex.empty()) {
+        return;
+    }
+
+    size_t quads = vertex.size() / 4;
+
+    if (quads > MAX_QUADS) {
+        LOG("text batch: dropping %d quads", static_cast<int>(quads - MAX_QUADS));
+        quads = MAX_QUADS;
+        vertex.resize(quads * 4);
+    }
+
+    VertexBufferPtr &vb = ring[next];
+
+    if (!vb || vb->index_count < quads * 6) {
+        size_t capacity = MIN_QUADS;
+        while (capacity < quads) {
+            capacity *= 2;
+        }
+
+        LOG("text batch buffer %d resized to %d quads", static_cast<int>(next), static_cast<int>(capacity));
+        vb = make_stream_buffer(quad_index, capacity);
+    }
+
+    vb->stream_vertex(vertex.data(), vertex.size() * sizeof(LetterVertex));
+
+    // position and size are per vertex
+    font_shader.set_font_width(1.f);
+    font_shader.set_trans(glm::vec2{0.f});
+    font_shader.set_anim_pass(AnimPass::all);
+
+    const ShaderPtr &shader = font_shader.shader();
+
+    // ranges past the dropped quads shrink or go away
+    auto draw = [&](const TexturePtr &tex, size_t first, size_t count) {
+        size_t end = std::min(first + count, quads);
+
+        if (first < end) {
+            draw_vertex_buffer(shader, *vb, tex, (end - first) * 6, first * 6);
+        }
+    };
+
+    draw(font.tex, 0, atlas_quads);
+
+    size_t first = atlas_quads;
+
+    for (size_t p = 0; p < page_vertex.size(); p++) {
+        size_t count = page_vertex[p].size() / 4;
+
+        if (count > 0) {
+            draw(glyph_cache->pages[p].tex, first, count);
+        }
+
+        first += count;
+        page_vertex[p].clear();
+    }
+
+    vertex.clear();
+    next = (next + 1) % RING;
+    flushes++;
+
+    cpu_ns += SDL_GetTicksNS() - start;
+}
+
+float TextBatch::glyphs_per_ms() const {
+    if (cpu_ns == 0) {
+        return 0.f;
+    }
+
+    return static_cast<float>(static_cast<double>(glyphs) / (static_cast<double>(cpu_ns) * 1e-6));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "font.hpp"
+#include "glyph_cache.hpp"
+#include "gl_helper.hpp"
+
+// Collects quads for any number of strings and draws them with one draw call.
+// Vertex data is streamed into a ring of buffers, so a buffer the GPU may still be
+// reading from isn't written to until RING frames later. Each write also orphans the storage.
+// Strings are UTF-8 once glyph_cache is set, characters the atlas lacks come from the cache and
+// cost one more draw per cache page they're on. Without it bytes are Latin-1.
+//
+// Usage per frame:
+//   batch.add("hello", pos, size);
+//   batch.add("world", pos2, size);
+//   batch.flush(font_shader, font, quad_index);
+struct TextBatch {
+    static constexpr size_t RING = 3;
+
+    std::array<VertexBufferPtr, RING> ring{
+        VertexBufferPtr{{}, {}},
+        VertexBufferPtr{{}, {}},
+        VertexBufferPtr{{}, {}},
+    };
+    size_t next = 0;
+
+    GlyphCache *glyph_cache = nullptr;  // only used once it's ready
+
+    std::vector<LetterVertex> vertex;
+    std::vector<std::vector<LetterVertex>> page_vertex;  // glyphs from each cache page
+    std::vector<glm::vec4> scratch;
+    std::vector<std::vector<glm::vec4>> page_scratch;
+
+    uint64_t glyphs = 0;
+    uint64_t flushes = 0;
+    uint64_t cpu_ns = 0;  // time spent in add and flush
+
+    // pos is the start of the baseline, size is the glyph width in normalized units.
+    // slot 0 draws with the font shader's fg color, otherwise the animation slot is used.
+    void add(FontAtlas &font, const std::string &str, const glm::vec2 &pos, float size, int slot = 0);
+    void flush(FontShader &font_shader, const FontAtlas &font, QuadIndex &quad_index);
+
+    float glyphs_per_ms() const;
+};
@@ -0,0 +1,160 @@
+#include "trace.hpp"
+
+#ifdef ENABLE_TRACE
+
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_thread.h>
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "log.hpp"
+
+namespace {
+std::atomic<TraceBuffer *> buffers = nullptr;
+thread_local TraceBuffer *local = nullptr;
+
+// names are literals, only quotes and backslashes need escaping
+void append_string(std::string &out, const char *s) {
+    out += '"';
+
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            out += '\\';
+        }
+        out += *s;
+    }
+
+    out += '"';
+}
+}  // namespace
+
+TraceBuffer &trace_buffer() {
+    if (!local) {
+        local = new TraceBuffer;
+        local->thread_id = SDL_GetCurrentThreadID();
+
+        // push on the list, the writer only ever walks it
+        local->next = buffers.load(std::memory_order_relaxed);
+        while (!buffers.compare_exchange_weak(local->next, local, std::memory_order_release)) {
+        }
+    }
+
+    return *local;
+}
+
+TraceZone::TraceZone(const char *zone_name) : name(zone_name), start(SDL_GetTicksNS()) {}
+
+TraceZone::~TraceZone() {
+    uint64_t end = SDL_GetTicksNS();
+    TraceBuffer &b = trace_buffer();
+    uint64_t h = b.head.load(std::memory_order_relaxed);
+    TraceEvent &e = b.events[h % TraceBuffer::CAPACITY];
+
+    e.name.store(name, std::memory_order_relaxed);
+    e.start_ns.store(start, std::memory_order_relaxed);
+    e.dur_ns.store(end - start, std::memory_order_relaxed);
+    b.head.store(h + 1, std::memory_order_release);
+}
+
+void trace_thread_name(const char *name) { trace_buffer().thread_name.store(name, std::memory_order_release); }
+
+bool trace_write(const std::string &path) {
+    uint64_t start = SDL_GetTicksNS();
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    size_t events = 0;
+    uint64_t overwritten = 0;
+    char buf[160];
+
+    struct Event {
+        const char *name;
+        uint64_t start_ns;
+        uint64_t dur_ns;
+    };
+
+    std::vector<Event> copy;
+    copy.reserve(TraceBuffer::CAPACITY);
+
+    for (TraceBuffer *b = buffers.load(std::memory_order_acquire); b; b = b->next) {
+        const char *thread_name = b->thread_name.load(std::memory_order_acquire);
+
+        if (thread_name) {
+            snprintf(buf,
+                     sizeof(buf),
+                     "{\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu64 ",\"name\":\"thread_name\",\"args\":{\"name\":",
+                     b->thread_id);
+            json += buf;
+            append_string(json, thread_name);
+            json += "}},\n";
+        }
+
+        // copy what's in the ring, then drop the oldest events the thread may have overwritten meanwhile,
+        // including the slot of the event it's writing now
+        uint64_t h1 = b->head.load(std::memory_order_acquire);
+        uint64_t first = h1 > TraceBuffer::CAPACITY ? h1 - TraceBuffer::CAPACITY : 0;
+        copy.clear();
+
+        for (uint64_t i = first; i < h1; i++) {
+            const TraceEvent &e = b->events[i % TraceBuffer::CAPACITY];
+            copy.push_back(Event{e.name.load(std::memory_order_relaxed),
+                                 e.start_ns.load(std::memory_order_relaxed),
+                                 e.dur_ns.load(std::memory_order_relaxed)});
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t h2 = b->head.load(std::memory_order_relaxed);
+        uint64_t valid = h2 + 1 > TraceBuffer::CAPACITY ? h2 + 1 - TraceBuffer::CAPACITY : 0;
+        size_t skip = static_cast<size_t>(std::min(valid > first ? valid - first : 0, uint64_t{copy.size()}));
+
+        for (size_t i = skip; i < copy.size(); i++) {
+            const Event &e = copy[i];
+
+            json += "{\"ph\":\"X\",\"pid\":1,\"name\":";
+            append_string(json, e.name);
+            snprintf(buf,
+                     sizeof(buf),
+                     ",\"tid\":%" PRIu64 ",\"ts\":%.3f,\"dur\":%.3f},\n",
+                     b->thread_id,
+                     static_cast<double>(e.start_ns) * 1e-3,
+                     static_cast<double>(e.dur_ns) * 1e-3);
+            json += buf;
+        }
+
+        events += copy.size() - skip;
+        overwritten += first + skip;
+    }
+
+    // no trailing comma allowed
+    if (json.back() == '\n' && json[json.size() - 2] == ',') {
+        json.resize(json.size() - 2);
+    }
+
+    json += "\n]}\n";
+
+    if (!SDL_SaveFile(path.c_str(), json.data(), json.size())) {
+        LOG("can't save trace %s: %s", path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    LOG("trace: %d zones (%d older ones overwritten), %d KiB written to %s in %.1f ms",
+        static_cast<int>(events),
+        static_cast<int>(overwritten),
+        static_cast<int>(json.size() / 1024),
+        path.c_str(),
+        static_cast<double>(SDL_GetTicksNS() - start) * 1e-6);
+
+    return true;
+}
+
+#else
+
+bool trace_write(const std::string &path) {
+    (void)path;
+    return false;
+}
+
+#endif
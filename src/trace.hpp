@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+
+// Timeline of scoped zones on every thread, saved as Chrome trace event JSON for chrome://tracing or
+// ui.perfetto.dev. Only built with cmake -DTRACE=ON (ENABLE_TRACE), otherwise the macros compile to nothing.
+//
+//   TRACE_ZONE("upload");  // from here to the end of the scope
+//
+// Names must outlive the trace, e.g. string literals, only the pointer is kept.
+// Each thread appends to its own ring without locking and publishes each event with a release store of
+// its head. Once a ring is full the oldest zones are overwritten, so a trace always has the latest ones.
+
+#ifdef ENABLE_TRACE
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+constexpr bool TRACE_ENABLED = true;
+
+// Relaxed atomics so the writer can read a slot that is being overwritten, it throws those away after.
+struct TraceEvent {
+    std::atomic<const char *> name = nullptr;
+    std::atomic<uint64_t> start_ns = 0;
+    std::atomic<uint64_t> dur_ns = 0;
+};
+
+struct TraceBuffer {
+    static constexpr size_t CAPACITY = 1 << 15;  // power of two
+
+    std::array<TraceEvent, CAPACITY> events;
+    std::atomic<uint64_t> head = 0;  // events ever recorded, event i is in slot i % CAPACITY
+    std::atomic<const char *> thread_name = nullptr;
+    uint64_t thread_id = 0;
+    TraceBuffer *next = nullptr;  // list of all buffers, never freed so finished threads keep their zones
+};
+
+// The calling thread's buffer, made on first use.
+TraceBuffer &trace_buffer();
+
+struct TraceZone {
+    const char *name;
+    uint64_t start;
+
+    explicit TraceZone(const char *zone_name);
+    ~TraceZone();
+};
+
+void trace_thread_name(const char *name);
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CAT(trace_zone_, __LINE__)(name)
+#define TRACE_THREAD(name) trace_thread_name(name)
+
+#else
+
+constexpr bool TRACE_ENABLED = false;
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+
+#endif
+
+// Writes the zones still in every ring, safe while other threads keep recording. False without ENABLE_TRACE.
+bool trace_write(const std::string &path);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer, single consumer triple buffer.
+// The producer always has a slot to write and the consumer always reads the newest complete value,
+// neither side ever waits for the other.
+template <typename T>
+struct TripleBuffer {
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    std::array<T, 3> slot{};
+    std::atomic<uint8_t> middle{1};  // slot index | FRESH when the consumer hasn't taken it yet
+    uint8_t back_index = 0;          // producer only
+    uint8_t front_index = 2;         // consumer only
+
+    // producer
+    T &back() { return slot[back_index]; }
+
+    void publish() {
+        uint8_t prev = middle.exchange(static_cast<uint8_t>(back_index | FRESH), std::memory_order_acq_rel);
+        back_index = prev & INDEX;
+    }
+
+    // consumer, true if a newer value was published since the last call
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+
+        uint8_t prev = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = prev & INDEX;
+
+        return true;
+    }
+
+    const T &front() const { return slot[front_index]; }
+};
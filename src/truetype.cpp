@@ -0,0 +1,429 @@
+#include "truetype.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// composite glyphs referencing composite glyphs, real fonts stay far below this
+constexpr int MAX_COMPOSITE_DEPTH = 8;
+
+struct Reader {
+    const uint8_t *data;
+    size_t size;
+    bool ok = true;
+
+    uint32_t u8(size_t at) {
+        if (at + 1 > size) {
+            ok = false;
+            return 0;
+        }
+        return data[at];
+    }
+
+    uint32_t u16(size_t at) {
+        if (at + 2 > size) {
+            ok = false;
+            return 0;
+        }
+        return static_cast<uint32_t>(data[at] << 8 | data[at + 1]);
+    }
+
+    int32_t i16(size_t at) { return static_cast<int16_t>(u16(at)); }
+
+    uint32_t u32(size_t at) {
+        if (at + 4 > size) {
+            ok = false;
+            return 0;
+        }
+        return static_cast<uint32_t>(data[at]) << 24 | static_cast<uint32_t>(data[at + 1]) << 16 |
+               static_cast<uint32_t>(data[at + 2]) << 8 | data[at + 3];
+    }
+};
+
+uint32_t tag(const char *t) {
+    return static_cast<uint32_t>(t[0]) << 24 | static_cast<uint32_t>(t[1]) << 16 | static_cast<uint32_t>(t[2]) << 8 |
+           static_cast<uint32_t>(t[3]);
+}
+
+glm::vec2 transform(const float m[6], glm::vec2 p) {
+    return {m[0] * p.x + m[2] * p.y + m[4], m[1] * p.x + m[3] * p.y + m[5]};
+}
+
+glm::vec2 midpoint(glm::vec2 a, glm::vec2 b) { return (a + b) * 0.5f; }
+}  // namespace
+
+bool TrueTypeFont::load(const void *bytes, size_t size) {
+    data.assign(static_cast<const uint8_t *>(bytes), static_cast<const uint8_t *>(bytes) + size);
+
+    Reader r{data.data(), data.size()};
+
+    uint32_t version = r.u32(0);
+    if (version != 0x00010000 && version != tag("true")) {
+        return false;
+    }
+
+    uint32_t maxp = 0;
+    uint32_t hhea = 0;
+    uint32_t cmap_table = 0;
+    uint32_t num_tables = r.u16(4);
+
+    for (uint32_t i = 0; i < num_tables; i++) {
+        size_t rec = 12 + i * 16;
+        uint32_t t = r.u32(rec);
+        uint32_t offset = r.u32(rec + 8);
+        uint32_t length = r.u32(rec + 12);
+
+        if (static_cast<uint64_t>(offset) + length > data.size()) {
+            return false;
+        }
+
+        if (t == tag("head")) {
+            head = offset;
+        } else if (t == tag("maxp")) {
+            maxp = offset;
+        } else if (t == tag("hhea")) {
+            hhea = offset;
+        } else if (t == tag("hmtx")) {
+            hmtx = offset;
+        } else if (t == tag("loca")) {
+            loca = offset;
+        } else if (t == tag("glyf")) {
+            glyf = offset;
+            glyf_size = length;
+        } else if (t == tag("cmap")) {
+            cmap_table = offset;
+        }
+    }
+
+    if (!head || !maxp || !hhea || !hmtx || !loca || !glyf || !cmap_table) {
+        return false;
+    }
+
+    units_per_em = static_cast<int>(r.u16(head + 18));
+    loc_format = r.i16(head + 50);
+    num_glyphs = r.u16(maxp + 4);
+    ascender = r.i16(hhea + 4);
+    descender = r.i16(hhea + 6);
+    num_hmetrics = r.u16(hhea + 34);
+
+    // full Unicode (format 12) first, then the BMP (format 4)
+    uint32_t num_subtables = r.u16(cmap_table + 2);
+
+    for (int want : {12, 4}) {
+        for (uint32_t i = 0; i < num_subtables && !cmap; i++) {
+            size_t rec = cmap_table + 4 + i * 8;
+            uint32_t platform = r.u16(rec);
+            uint32_t encoding = r.u16(rec + 2);
+            uint32_t offset = cmap_table + r.u32(rec + 4);
+
+            bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+
+            if (unicode && static_cast<int>(r.u16(offset)) == want) {
+                cmap = offset;
+                cmap_format = want;
+            }
+        }
+    }
+
+    return r.ok && cmap && units_per_em > 0 && num_hmetrics > 0 && num_glyphs > 0;
+}
+
+uint32_t TrueTypeFont::glyph_index(uint32_t codepoint) const {
+    Reader r{data.data(), data.size()};
+
+    if (cmap_format == 12) {
+        uint32_t groups = r.u32(cmap + 12);
+
+        // groups are sorted by start code
+        uint32_t lo = 0;
+        uint32_t hi = groups;
+
+        while (lo < hi && r.ok) {
+            uint32_t mid = (lo + hi) / 2;
+            size_t g = cmap + 16 + mid * 12;
+            uint32_t start = r.u32(g);
+            uint32_t end = r.u32(g + 4);
+
+            if (codepoint < start) {
+                hi = mid;
+            } else if (codepoint > end) {
+                lo = mid + 1;
+            } else {
+                return r.u32(g + 8) + (codepoint - start);
+            }
+        }
+
+        return 0;
+    }
+
+    if (cmap_format == 4 && codepoint <= 0xFFFF) {
+        uint32_t seg_count = r.u16(cmap + 6) / 2;
+        size_t end_codes = cmap + 14;
+        size_t start_codes = end_codes + seg_count * 2 + 2;
+        size_t deltas = start_codes + seg_count * 2;
+        size_t range_offsets = deltas + seg_count * 2;
+
+        for (uint32_t i = 0; i < seg_count && r.ok; i++) {
+            if (codepoint > r.u16(end_codes + i * 2)) {
+                continue;
+            }
+
+            uint32_t start = r.u16(start_codes + i * 2);
+            if (codepoint < start) {
+                return 0;
+            }
+
+            uint32_t delta = r.u16(deltas + i * 2);
+            uint32_t range_offset = r.u16(range_offsets + i * 2);
+
+            if (range_offset == 0) {
+                return (codepoint + delta) & 0xFFFF;
+            }
+
+            // the offset is relative to its own position in the idRangeOffset array
+            uint32_t glyph = r.u16(range_offsets + i * 2 + range_offset + (codepoint - start) * 2);
+            return glyph == 0 ? 0 : (glyph + delta) & 0xFFFF;
+        }
+    }
+
+    return 0;
+}
+
+float TrueTypeFont::advance(uint32_t glyph) const {
+    // glyphs past the last metric repeat its advance
+    Reader r{data.data(), data.size()};
+    uint32_t metric = std::min(glyph, num_hmetrics - 1);
+    return static_cast<float>(r.u16(hmtx + metric * 4));
+}
+
+bool TrueTypeFont::outline(uint32_t glyph, GlyphOutline &out) const {
+    out = GlyphOutline{};
+
+    if (glyph >= num_glyphs) {
+        return false;
+    }
+
+    out.advance = advance(glyph);
+
+    const float identity[6] = {1, 0, 0, 1, 0, 0};
+    if (!add_outline(glyph, identity, 0, out)) {
+        out.contours.clear();
+        return false;
+    }
+
+    bool first = true;
+    for (const auto &contour : out.contours) {
+        for (const OutlineEdge &e : contour) {
+            for (glm::vec2 p : {e.p0, e.c, e.p1}) {
+                if (!e.curve && p == e.c) {
+                    continue;
+                }
+
+                out.min = first ? p : glm::vec2{std::min(out.min.x, p.x), std::min(out.min.y, p.y)};
+                out.max = first ? p : glm::vec2{std::max(out.max.x, p.x), std::max(out.max.y, p.y)};
+                first = false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool TrueTypeFont::add_outline(uint32_t glyph, const float m[6], int depth, GlyphOutline &out) const {
+    if (depth > MAX_COMPOSITE_DEPTH || glyph >= num_glyphs) {
+        return false;
+    }
+
+    Reader r{data.data(), data.size()};
+
+    uint32_t start = loc_format == 0 ? r.u16(loca + glyph * 2) * 2 : r.u32(loca + glyph * 4);
+    uint32_t end = loc_format == 0 ? r.u16(loca + glyph * 2 + 2) * 2 : r.u32(loca + glyph * 4 + 4);
+
+    if (!r.ok || end < start || end > glyf_size) {
+        return false;
+    }
+
+    // no outline
+    if (start == end) {
+        return true;
+    }
+
+    // keep reads inside this glyph's record
+    Reader g{data.data() + glyf + start, end - start};
+    int32_t num_contours = g.i16(0);
+
+    if (num_contours < 0) {
+        size_t at = 10;
+        uint32_t flags;
+
+        do {
+            flags = g.u16(at);
+            uint32_t component = g.u16(at + 2);
+            at += 4;
+
+            float dx = 0;
+            float dy = 0;
+
+            if (flags & 0x0001) {  // ARG_1_AND_2_ARE_WORDS
+                dx = static_cast<float>(g.i16(at));
+                dy = static_cast<float>(g.i16(at + 2));
+                at += 4;
+            } else {
+                dx = static_cast<float>(static_cast<int8_t>(g.u8(at)));
+                dy = static_cast<float>(static_cast<int8_t>(g.u8(at + 1)));
+                at += 2;
+            }
+
+            // point matching placement isn't supported, the component stays at the origin
+            if (!(flags & 0x0002)) {  // ARGS_ARE_XY_VALUES
+                dx = 0;
+                dy = 0;
+            }
+
+            auto f2dot14 = [&](size_t a) { return static_cast<float>(g.i16(a)) / 16384.f; };
+            float c[6] = {1, 0, 0, 1, dx, dy};
+
+            if (flags & 0x0008) {  // WE_HAVE_A_SCALE
+                c[0] = c[3] = f2dot14(at);
+                at += 2;
+            } else if (flags & 0x0040) {  // WE_HAVE_AN_X_AND_Y_SCALE
+                c[0] = f2dot14(at);
+                c[3] = f2dot14(at + 2);
+                at += 4;
+            } else if (flags & 0x0080) {  // WE_HAVE_A_TWO_BY_TWO
+                c[0] = f2dot14(at);
+                c[1] = f2dot14(at + 2);
+                c[2] = f2dot14(at + 4);
+                c[3] = f2dot14(at + 6);
+                at += 8;
+            }
+
+            // parent * component
+            float t[6] = {m[0] * c[0] + m[2] * c[1],
+                          m[1] * c[0] + m[3] * c[1],
+                          m[0] * c[2] + m[2] * c[3],
+                          m[1] * c[2] + m[3] * c[3],
+                          m[0] * c[4] + m[2] * c[5] + m[4],
+                          m[1] * c[4] + m[3] * c[5] + m[5]};
+
+            if (!g.ok || !add_outline(component, t, depth + 1, out)) {
+                return false;
+            }
+        } while (flags & 0x0020);  // MORE_COMPONENTS
+
+        return true;
+    }
+
+    std::vector<uint32_t> end_points(static_cast<size_t>(num_contours));
+    for (size_t i = 0; i < end_points.size(); i++) {
+        end_points[i] = g.u16(10 + i * 2);
+    }
+
+    if (!g.ok || end_points.empty()) {
+        return g.ok;
+    }
+
+    size_t num_points = end_points.back() + 1;
+    size_t at = 10 + end_points.size() * 2;
+    at += 2 + g.u16(at);  // skip the instructions
+
+    std::vector<uint8_t> flags(num_points);
+    for (size_t i = 0; i < num_points && g.ok;) {
+        uint8_t f = static_cast<uint8_t>(g.u8(at++));
+        size_t repeat = (f & 0x08) ? g.u8(at++) : 0;
+
+        for (size_t k = 0; k <= repeat && i < num_points; k++) {
+            flags[i++] = f;
+        }
+    }
+
+    // coordinates are deltas, short ones carry their sign in the SAME_OR_POSITIVE flag
+    std::vector<glm::vec2> points(num_points);
+    for (int axis = 0; axis < 2; axis++) {
+        uint8_t short_flag = axis == 0 ? 0x02 : 0x04;
+        uint8_t same_flag = axis == 0 ? 0x10 : 0x20;
+        int32_t v = 0;
+
+        for (size_t i = 0; i < num_points; i++) {
+            if (flags[i] & short_flag) {
+                int32_t d = static_cast<int32_t>(g.u8(at++));
+                v += (flags[i] & same_flag) ? d : -d;
+            } else if (!(flags[i] & same_flag)) {
+                v += g.i16(at);
+                at += 2;
+            }
+
+            points[i][axis] = static_cast<float>(v);
+        }
+    }
+
+    if (!g.ok) {
+        return false;
+    }
+
+    size_t first = 0;
+    for (uint32_t last : end_points) {
+        if (last < first || last >= num_points) {
+            return false;
+        }
+
+        size_t n = last - first + 1;
+        auto pt = [&](size_t i) { return transform(m, points[first + i % n]); };
+        auto on = [&](size_t i) { return (flags[first + i % n] & 0x01) != 0; };
+
+        std::vector<OutlineEdge> contour;
+
+        // start on an on-curve point, or between two off-curve ones
+        size_t s = 0;
+        while (s < n && !on(s)) {
+            s++;
+        }
+
+        glm::vec2 start_pt = s < n ? pt(s) : midpoint(pt(0), pt(1));
+        if (s == n) {
+            s = 0;
+        }
+
+        glm::vec2 cur = start_pt;
+        glm::vec2 ctrl{};
+        bool has_ctrl = false;
+
+        for (size_t k = 1; k <= n; k++) {
+            size_t i = s + k;
+            glm::vec2 p = pt(i);
+
+            // the start point closes the contour
+            if (k == n) {
+                p = start_pt;
+            }
+
+            if (on(i) || k == n) {
+                if (has_ctrl) {
+                    contour.push_back(OutlineEdge{cur, ctrl, p, true});
+                } else if (p != cur) {
+                    contour.push_back(OutlineEdge{cur, cur, p, false});
+                }
+
+                cur = p;
+                has_ctrl = false;
+            } else if (has_ctrl) {
+                // two off-curve points imply an on-curve one between them
+                glm::vec2 mid = midpoint(ctrl, p);
+                contour.push_back(OutlineEdge{cur, ctrl, mid, true});
+                cur = mid;
+                ctrl = p;
+            } else {
+                ctrl = p;
+                has_ctrl = true;
+            }
+        }
+
+        if (!contour.empty()) {
+            out.contours.push_back(std::move(contour));
+        }
+
+        first = last + 1;
+    }
+
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <vector>
+
+// Minimal TrueType reader, just enough to generate glyphs: cmap (formats 4 and 12), hmtx and
+// quadratic glyf outlines, including composite glyphs. No hinting, kerning or CFF outlines.
+// Every read is bounds checked, a malformed font fails to load or yields empty outlines.
+
+// Line when curve is false, otherwise a quadratic with control point c. Font units, y up.
+struct OutlineEdge {
+    glm::vec2 p0{};
+    glm::vec2 c{};
+    glm::vec2 p1{};
+    bool curve = false;
+};
+
+struct GlyphOutline {
+    std::vector<std::vector<OutlineEdge>> contours;  // closed, clockwise for filled areas
+    float advance = 0.f;                              // font units
+    glm::vec2 min{};                                  // bounding box of the points, font units
+    glm::vec2 max{};
+};
+
+struct TrueTypeFont {
+    std::vector<uint8_t> data;
+
+    int units_per_em = 0;
+    int ascender = 0;
+    int descender = 0;
+    uint32_t num_glyphs = 0;
+
+    bool load(const void *bytes, size_t size);
+
+    // 0, the missing glyph, when the font doesn't map codepoint
+    uint32_t glyph_index(uint32_t codepoint) const;
+    // font units, without parsing the outline
+    float advance(uint32_t glyph) const;
+    // False for malformed data. A glyph without contours (a space) succeeds with none.
+    bool outline(uint32_t glyph, GlyphOutline &out) const;
+
+private:
+    uint32_t head = 0;
+    uint32_t loca = 0;
+    uint32_t glyf = 0;
+    uint32_t glyf_size = 0;
+    uint32_t hmtx = 0;
+    uint32_t cmap = 0;  // the chosen subtable
+    int cmap_format = 0;
+    int loc_format = 0;
+    uint32_t num_hmetrics = 0;
+
+    bool add_outline(uint32_t glyph, const float m[6], int depth, GlyphOutline &out) const;
+};
@@ -0,0 +1,138 @@
+#include "vfs.hpp"
+
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_timer.h>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VFS_MMAP
+#endif
+
+#include "log.hpp"
+#include "trace.hpp"
+
+namespace {
+#ifdef VFS_MMAP
+// nullptr if the file can't be mapped
+const uint8_t *map_file(const std::string &path, size_t &size) {
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    void *p = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = static_cast<size_t>(st.st_size);
+        p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    // the mapping keeps the file open
+    close(fd);
+
+    return p == MAP_FAILED ? nullptr : static_cast<const uint8_t *>(p);
+}
+#endif
+}  // namespace
+
+bool Vfs::mount(const std::string &root_dir, const std::string &pack_name) {
+    unmount();
+    root = root_dir;
+
+    uint64_t start = SDL_GetTicksNS();
+    std::string path = root + pack_name;
+
+#ifdef VFS_MMAP
+    data = map_file(path, size);
+    mapped = data != nullptr;
+#endif
+
+    if (!data) {
+        data = static_cast<const uint8_t *>(SDL_LoadFile(path.c_str(), &size));
+    }
+
+    if (!data) {
+        LOG("no %s, reading loose asset files", path.c_str());
+        return true;
+    }
+
+    if (const char *err = view_asset_pack(data, size, pack)) {
+        LOG("%s: %s", path.c_str(), err);
+        unmount();
+        return false;
+    }
+
+    LOG("mounted %s: %d entries, %zu KiB, %s in %.3f ms",
+        path.c_str(),
+        static_cast<int>(pack.header->entry_count),
+        size / 1024,
+        mapped ? "mapped" : "read",
+        static_cast<double>(SDL_GetTicksNS() - start) * 1e-6);
+
+    return true;
+}
+
+void Vfs::unmount() {
+    if (data) {
+#ifdef VFS_MMAP
+        if (mapped) {
+            munmap(const_cast<uint8_t *>(data), size);
+        }
+#endif
+        if (!mapped) {
+            SDL_free(const_cast<uint8_t *>(data));
+        }
+    }
+
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    pack = PackView{};
+}
+
+AssetData Vfs::read(const std::string &name) {
+    AssetData asset;
+
+    if (const PackEntry *e = pack.header ? pack.find(name) : nullptr) {
+        const uint8_t *stored = data + e->offset;
+
+        if (!(e->flags & PACK_COMPRESSED)) {
+            zero_copy_reads++;
+            asset.bytes = {stored, static_cast<size_t>(e->size)};
+            return asset;
+        }
+
+        TRACE_ZONE("asset decompress");
+
+        // +1 so an empty entry still gets a buffer
+        size_t raw_size = static_cast<size_t>(e->raw_size);
+        uint8_t *raw = static_cast<uint8_t *>(SDL_malloc(raw_size + 1));
+
+        if (!raw || !lz_decompress(stored, static_cast<size_t>(e->size), raw, raw_size)) {
+            LOG("corrupt packed asset %s", name.c_str());
+            SDL_free(raw);
+            return asset;
+        }
+
+        decompressed_reads++;
+        asset.owned.reset(raw);
+        asset.bytes = {raw, raw_size};
+        return asset;
+    }
+
+    size_t file_size = 0;
+    void *file = SDL_LoadFile((root + name).c_str(), &file_size);
+
+    if (file) {
+        loose_reads++;
+        asset.owned.reset(file);
+        asset.bytes = {static_cast<const uint8_t *>(file), file_size};
+    }
+
+    return asset;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <SDL3/SDL_stdinc.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "asset_pack.hpp"
+
+// Bytes of one asset. Points into the mounted archive for stored entries, owns a buffer otherwise.
+struct AssetData {
+    std::span<const uint8_t> bytes;
+    std::unique_ptr<void, void (*)(void *)> owned{nullptr, SDL_free};
+
+    explicit operator bool() const { return bytes.data() != nullptr; }
+};
+
+// Assets by name, from the packed archive (see asset_pack.hpp) with loose files under root for names
+// it doesn't have, so the app still runs from a plain asset directory.
+// The archive is memory mapped on desktop Linux and macOS. Elsewhere it's read once with SDL_LoadFile,
+// which can also read from inside an Android APK.
+struct Vfs {
+    std::string root;
+    PackView pack;
+    const uint8_t *data = nullptr;  // the whole archive
+    size_t size = 0;
+    bool mapped = false;
+
+    // read() may run on several threads at once during startup
+    std::atomic<uint64_t> zero_copy_reads = 0;
+    std::atomic<uint64_t> decompressed_reads = 0;
+    std::atomic<uint64_t> loose_reads = 0;
+
+    Vfs() = default;
+    Vfs(const Vfs &) = delete;
+    Vfs &operator=(const Vfs &) = delete;
+    ~Vfs() { unmount(); }
+
+    // False for a corrupt archive. Without a valid one every read goes to the loose files.
+    bool mount(const std::string &root_dir, const std::string &pack_name = "assets.pak");
+    void unmount();
+
+    // Empty when name is neither packed nor a readable file. Stored entries are valid until unmount().
+    // Thread safe while mounted.
+    AssetData read(const std::string &name);
+};
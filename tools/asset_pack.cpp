@@ -0,0 +1,123 @@
+// Packs asset files into one archive for the app's Vfs.
+//
+//   asset_pack assets/assets.pak assets atlas.bin atlas.ktx -z atlas.bmp -z atlas.txt
+//
+// Names are paths relative to the root directory, -z compresses the next one.
+// See src/asset_pack.hpp for the layout.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "asset_pack.hpp"
+
+namespace {
+bool read_file(const std::string &path, std::vector<uint8_t> &data) {
+    FILE *f = fopen(path.c_str(), "rb");
+
+    if (!f) {
+        fprintf(stderr, "can't open %s\n", path.c_str());
+        return false;
+    }
+
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+
+    fclose(f);
+
+    return true;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s out.pak root [-z] name...\n", argv[0]);
+        return 1;
+    }
+
+    std::string root = std::string(argv[2]) + "/";
+    std::vector<PackInput> inputs;
+    bool compress = false;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-z") == 0) {
+            compress = true;
+            continue;
+        }
+
+        PackInput in;
+        in.name = argv[i];
+        in.compress = compress;
+        compress = false;
+
+        if (!read_file(root + in.name, in.data)) {
+            return 1;
+        }
+
+        inputs.push_back(std::move(in));
+    }
+
+    // kept to check the round trip
+    std::vector<std::vector<uint8_t>> originals;
+    std::vector<std::string> names;
+    for (const PackInput &in : inputs) {
+        originals.push_back(in.data);
+        names.push_back(in.name);
+    }
+
+    std::vector<uint8_t> out = write_asset_pack(inputs);
+
+    // what the app will check at load, plus the contents
+    PackView view;
+    if (const char *err = view_asset_pack(out.data(), out.size(), view)) {
+        fprintf(stderr, "packed archive is invalid: %s\n", err);
+        return 1;
+    }
+
+    for (size_t i = 0; i < names.size(); i++) {
+        const PackEntry *e = view.find(names[i]);
+        std::vector<uint8_t> data(originals[i].size());
+
+        bool ok = e && e->raw_size == data.size();
+
+        if (ok && (e->flags & PACK_COMPRESSED)) {
+            ok = lz_decompress(out.data() + e->offset, e->size, data.data(), data.size());
+        } else if (ok && !data.empty()) {
+            memcpy(data.data(), out.data() + e->offset, data.size());
+        }
+
+        if (!ok || data != originals[i]) {
+            fprintf(stderr, "%s doesn't round trip\n", names[i].c_str());
+            return 1;
+        }
+
+        printf("%-24s %10d -> %10d bytes%s\n",
+               names[i].c_str(),
+               static_cast<int>(e->raw_size),
+               static_cast<int>(e->size),
+               (e->flags & PACK_COMPRESSED) ? ", compressed" : "");
+    }
+
+    FILE *f = fopen(argv[1], "wb");
+
+    if (!f || fwrite(out.data(), 1, out.size(), f) != out.size()) {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        if (f) {
+            fclose(f);
+        }
+        return 1;
+    }
+
+    fclose(f);
+
+    printf("%s: %d entries, %d bytes\n",
+           argv[1],
+           static_cast<int>(view.header->entry_count),
+           static_cast<int>(out.size()));
+
+    return 0;
+}
@@ -0,0 +1,396 @@
+// Offline converter from the MSDF atlas BMP to an ETC2 KTX file with a full mip chain.
+//
+//   atlas_compress assets/atlas.bmp assets/atlas.ktx
+//
+// The blocks are ETC1 encoded, every ETC1 block is a valid ETC2 RGB8 block as long as the
+// differential mode doesn't overflow, so the output loads as GL_COMPRESSED_RGB8_ETC2.
+// Standalone on purpose so it builds for the host even when cross compiling the app.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint32_t GL_COMPRESSED_RGB8_ETC2 = 0x9274;
+constexpr uint32_t GL_RGB = 0x1907;
+
+constexpr int MODIFIER[8][4] = {
+    {2, 8, -2, -8},
+    {5, 17, -5, -17},
+    {9, 29, -9, -29},
+    {13, 42, -13, -42},
+    {18, 60, -18, -60},
+    {24, 80, -24, -80},
+    {33, 106, -33, -106},
+    {47, 183, -47, -183},
+};
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;  // top row first
+
+    const uint8_t *pixel(int x, int y) const {
+        x = std::min(x, width - 1);
+        y = std::min(y, height - 1);
+        return &rgb[static_cast<size_t>((y * width + x) * 3)];
+    }
+};
+
+uint32_t read_u32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+           static_cast<uint32_t>(p[3]) << 24;
+}
+
+uint16_t read_u16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+
+bool load_bmp(const char *path, Image &img) {
+    FILE *f = fopen(path, "rb");
+
+    if (!f) {
+        fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+
+    fclose(f);
+
+    if (data.size() < 54 || data[0] != 'B' || data[1] != 'M') {
+        fprintf(stderr, "%s is not a BMP file\n", path);
+        return false;
+    }
+
+    uint32_t offset = read_u32(&data[10]);
+    int32_t width = static_cast<int32_t>(read_u32(&data[18]));
+    int32_t height = static_cast<int32_t>(read_u32(&data[22]));
+    uint16_t bpp = read_u16(&data[28]);
+    uint32_t compression = read_u32(&data[30]);
+
+    // BI_RGB, or BI_BITFIELDS with the default 32 bit masks
+    if ((bpp != 24 && bpp != 32) || (compression != 0 && compression != 3) || width <= 0 || height == 0) {
+        fprintf(stderr, "%s: only uncompressed 24 or 32 bit BMP files are supported\n", path);
+        return false;
+    }
+
+    bool bottom_up = height > 0;
+    height = std::abs(height);
+
+    size_t bytes = bpp / 8;
+    size_t pitch = (static_cast<size_t>(width) * bytes + 3) & ~static_cast<size_t>(3);
+
+    if (offset + pitch * static_cast<size_t>(height) > data.size()) {
+        fprintf(stderr, "%s is truncated\n", path);
+        return false;
+    }
+
+    img.width = width;
+    img.height = height;
+    img.rgb.resize(static_cast<size_t>(width * height * 3));
+
+    for (int y = 0; y < height; y++) {
+        int src_y = bottom_up ? height - 1 - y : y;
+        const uint8_t *src = &data[offset + pitch * static_cast<size_t>(src_y)];
+        uint8_t *dst = &img.rgb[static_cast<size_t>(y * width * 3)];
+
+        for (int x = 0; x < width; x++, src += bytes, dst += 3) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+        }
+    }
+
+    return true;
+}
+
+// 2x2 box filter, odd sizes clamp to the last row or column
+Image downsample(const Image &src) {
+    Image dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.rgb.resize(static_cast<size_t>(dst.width * dst.height * 3));
+
+    for (int y = 0; y < dst.height; y++) {
+        for (int x = 0; x < dst.width; x++) {
+            for (int c = 0; c < 3; c++) {
+                int sum = src.pixel(x * 2, y * 2)[c] + src.pixel(x * 2 + 1, y * 2)[c] +
+                          src.pixel(x * 2, y * 2 + 1)[c] + src.pixel(x * 2 + 1, y * 2 + 1)[c];
+                dst.rgb[static_cast<size_t>((y * dst.width + x) * 3 + c)] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+
+    return dst;
+}
+
+int clamp255(int v) { return std::clamp(v, 0, 255); }
+
+int expand4(int v) { return v << 4 | v; }
+int expand5(int v) { return v << 3 | v >> 2; }
+
+// pixels of one 2x4 or 4x2 sub block, with their index inside the 4x4 block
+struct SubBlock {
+    std::array<std::array<int, 3>, 8> color;
+    std::array<int, 8> index;
+};
+
+struct SubResult {
+    int error = std::numeric_limits<int>::max();
+    int table = 0;
+    std::array<int, 8> selector{};
+};
+
+// best table and per pixel modifier for a fixed base color
+SubResult fit_sub_block(const SubBlock &sb, const std::array<int, 3> &base) {
+    SubResult best;
+
+    for (int t = 0; t < 8; t++) {
+        SubResult r;
+        r.table = t;
+        r.error = 0;
+
+        for (size_t i = 0; i < 8; i++) {
+            int best_err = std::numeric_limits<int>::max();
+
+            for (int m = 0; m < 4; m++) {
+                int err = 0;
+                for (size_t c = 0; c < 3; c++) {
+                    int d = clamp255(base[c] + MODIFIER[t][m]) - sb.color[i][c];
+                    err += d * d;
+                }
+
+                if (err < best_err) {
+                    best_err = err;
+                    r.selector[i] = m;
+                }
+            }
+
+            r.error += best_err;
+        }
+
+        if (r.error < best.error) {
+            best = r;
+        }
+    }
+
+    return best;
+}
+
+std::array<int, 3> average(const SubBlock &sb) {
+    std::array<int, 3> sum{};
+
+    for (const auto &c : sb.color) {
+        for (size_t i = 0; i < 3; i++) {
+            sum[i] += c[i];
+        }
+    }
+
+    return {(sum[0] + 4) / 8, (sum[1] + 4) / 8, (sum[2] + 4) / 8};
+}
+
+struct Candidate {
+    int error = std::numeric_limits<int>::max();
+    uint64_t bits = 0;
+};
+
+uint64_t pack_selectors(const SubResult &r0, const SubBlock &s0, const SubResult &r1, const SubBlock &s1) {
+    uint32_t msb = 0;
+    uint32_t lsb = 0;
+
+    auto put = [&](const SubResult &r, const SubBlock &sb) {
+        for (size_t i = 0; i < 8; i++) {
+            // selector order in MODIFIER is {+a, +b, -a, -b}, which is lsb | msb << 1
+            uint32_t sel = static_cast<uint32_t>(r.selector[i]);
+            uint32_t bit = static_cast<uint32_t>(sb.index[i]);
+            lsb |= (sel & 1u) << bit;
+            msb |= (sel >> 1) << bit;
+        }
+    };
+
+    put(r0, s0);
+    put(r1, s1);
+
+    return static_cast<uint64_t>(msb) << 16 | lsb;
+}
+
+Candidate encode_individual(const SubBlock &s0, const SubBlock &s1, bool flip) {
+    std::array<int, 3> q0, q1, b0, b1;
+    auto a0 = average(s0);
+    auto a1 = average(s1);
+
+    for (size_t c = 0; c < 3; c++) {
+        q0[c] = std::clamp((a0[c] * 15 + 127) / 255, 0, 15);
+        q1[c] = std::clamp((a1[c] * 15 + 127) / 255, 0, 15);
+        b0[c] = expand4(q0[c]);
+        b1[c] = expand4(q1[c]);
+    }
+
+    SubResult r0 = fit_sub_block(s0, b0);
+    SubResult r1 = fit_sub_block(s1, b1);
+
+    uint64_t hi = static_cast<uint64_t>(q0[0] << 4 | q1[0]) << 24 | static_cast<uint64_t>(q0[1] << 4 | q1[1]) << 16 |
+                  static_cast<uint64_t>(q0[2] << 4 | q1[2]) << 8 |
+                  static_cast<uint64_t>(r0.table << 5 | r1.table << 2 | (flip ? 1 : 0));
+
+    return {r0.error + r1.error, hi << 32 | pack_selectors(r0, s0, r1, s1)};
+}
+
+Candidate encode_differential(const SubBlock &s0, const SubBlock &s1, bool flip) {
+    std::array<int, 3> q0, d, b0, b1;
+    auto a0 = average(s0);
+    auto a1 = average(s1);
+
+    for (size_t c = 0; c < 3; c++) {
+        q0[c] = std::clamp((a0[c] * 31 + 127) / 255, 0, 31);
+        int q1 = std::clamp((a1[c] * 31 + 127) / 255, 0, 31);
+        d[c] = q1 - q0[c];
+
+        // out of range deltas would be read as the ETC2 T, H or planar modes
+        if (d[c] < -4 || d[c] > 3) {
+            return {};
+        }
+
+        b0[c] = expand5(q0[c]);
+        b1[c] = expand5(q1);
+    }
+
+    SubResult r0 = fit_sub_block(s0, b0);
+    SubResult r1 = fit_sub_block(s1, b1);
+
+    auto field = [&](size_t c) { return static_cast<uint64_t>(q0[c] << 3 | (d[c] & 7)); };
+
+    uint64_t hi = field(0) << 24 | field(1) << 16 | field(2) << 8 |
+                  static_cast<uint64_t>(r0.table << 5 | r1.table << 2 | 2 | (flip ? 1 : 0));
+
+    return {r0.error + r1.error, hi << 32 | pack_selectors(r0, s0, r1, s1)};
+}
+
+uint64_t encode_block(const Image &img, int bx, int by) {
+    Candidate best;
+
+    for (bool flip : {false, true}) {
+        SubBlock s[2];
+        int n[2] = {0, 0};
+
+        for (int x = 0; x < 4; x++) {
+            for (int y = 0; y < 4; y++) {
+                // flip 0 splits left | right, flip 1 splits top / bottom
+                int sub = flip ? (y >= 2) : (x >= 2);
+                const uint8_t *p = img.pixel(bx + x, by + y);
+                size_t i = static_cast<size_t>(n[sub]++);
+                s[sub].color[i] = {p[0], p[1], p[2]};
+                s[sub].index[i] = x * 4 + y;
+            }
+        }
+
+        for (const Candidate &c : {encode_individual(s[0], s[1], flip), encode_differential(s[0], s[1], flip)}) {
+            if (c.error < best.error) {
+                best = c;
+            }
+        }
+    }
+
+    return best.bits;
+}
+
+std::vector<uint8_t> encode_etc(const Image &img) {
+    std::vector<uint8_t> out;
+
+    for (int by = 0; by < img.height; by += 4) {
+        for (int bx = 0; bx < img.width; bx += 4) {
+            uint64_t bits = encode_block(img, bx, by);
+
+            // big endian
+            for (int i = 7; i >= 0; i--) {
+                out.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+            }
+        }
+    }
+
+    return out;
+}
+
+void put_u32(std::vector<uint8_t> &out, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <atlas.bmp> <atlas.ktx>\n", argv[0]);
+        return 1;
+    }
+
+    Image img;
+    if (!load_bmp(argv[1], img)) {
+        return 1;
+    }
+
+    std::vector<Image> mips{img};
+    while (mips.back().width > 1 || mips.back().height > 1) {
+        mips.push_back(downsample(mips.back()));
+    }
+
+    // KTX 1.1, https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+    static const uint8_t KTX_ID[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    std::vector<uint8_t> out(KTX_ID, KTX_ID + sizeof(KTX_ID));
+    put_u32(out, 0x04030201);  // endianness
+    put_u32(out, 0);           // glType, compressed
+    put_u32(out, 1);           // glTypeSize
+    put_u32(out, 0);           // glFormat, compressed
+    put_u32(out, GL_COMPRESSED_RGB8_ETC2);
+    put_u32(out, GL_RGB);
+    put_u32(out, static_cast<uint32_t>(img.width));
+    put_u32(out, static_cast<uint32_t>(img.height));
+    put_u32(out, 0);  // depth
+    put_u32(out, 0);  // array elements
+    put_u32(out, 1);  // faces
+    put_u32(out, static_cast<uint32_t>(mips.size()));
+    put_u32(out, 0);  // key value data
+
+    size_t total = 0;
+
+    for (const Image &mip : mips) {
+        std::vector<uint8_t> level = encode_etc(mip);
+        put_u32(out, static_cast<uint32_t>(level.size()));
+        out.insert(out.end(), level.begin(), level.end());
+        total += level.size();
+    }
+
+    FILE *f = fopen(argv[2], "wb");
+
+    if (!f || fwrite(out.data(), 1, out.size(), f) != out.size()) {
+        fprintf(stderr, "can't write %s\n", argv[2]);
+        if (f) {
+            fclose(f);
+        }
+        return 1;
+    }
+
+    fclose(f);
+
+    size_t raw = static_cast<size_t>(img.width * img.height * 3);
+    printf("%s: %dx%d, %zu mips, %zu bytes of ETC2 (%zu bytes RGB8 for level 0 alone)\n",
+           argv[2],
+           img.width,
+           img.height,
+           mips.size(),
+           total,
+           raw);
+
+    return 0;
+}
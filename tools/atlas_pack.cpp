@@ -0,0 +1,81 @@
+// Offline converter from the msdf-atlas-gen text metrics to the binary atlas the app loads in place.
+//
+//   atlas_pack assets/atlas.txt assets/atlas.bin
+//
+// See src/atlas_format.hpp for the layout.
+
+#include <cstdio>
+#include <vector>
+
+#include "atlas_format.hpp"
+
+namespace {
+bool read_file(const char *path, std::vector<char> &data) {
+    FILE *f = fopen(path, "rb");
+
+    if (!f) {
+        fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+
+    fclose(f);
+    data.push_back('\0');
+
+    return true;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s atlas.txt atlas.bin\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<char> text;
+    if (!read_file(argv[1], text)) {
+        return 1;
+    }
+
+    AtlasHeader header;
+    std::vector<std::pair<int, Glyph>> glyphs;
+
+    if (const char *err = parse_atlas_txt(text.data(), header, glyphs)) {
+        fprintf(stderr, "%s: %s\n", argv[1], err);
+        return 1;
+    }
+
+    std::vector<uint8_t> out = write_atlas_bin(header, glyphs);
+
+    // what the app will check at load
+    AtlasView view;
+    if (const char *err = view_atlas_bin(out.data(), out.size(), view)) {
+        fprintf(stderr, "packed atlas is invalid: %s\n", err);
+        return 1;
+    }
+
+    FILE *f = fopen(argv[2], "wb");
+
+    if (!f || fwrite(out.data(), 1, out.size(), f) != out.size()) {
+        fprintf(stderr, "can't write %s\n", argv[2]);
+        if (f) {
+            fclose(f);
+        }
+        return 1;
+    }
+
+    fclose(f);
+
+    printf("%s: %d glyphs, %d bytes (text was %d bytes)\n",
+           argv[2],
+           static_cast<int>(view.header->glyph_count),
+           static_cast<int>(out.size()),
+           static_cast<int>(text.size() - 1));
+
+    return 0;
+}
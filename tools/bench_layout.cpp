@@ -0,0 +1,184 @@
+// Benchmark for text layout at 1, 100 and 10k glyphs. Compares the layout kernel (flat glyph table,
+// positions, uv and bounding box in one pass into preallocated storage) against the std::map lookup
+// it replaced followed by a separate bounding box pass.
+//
+//   bench_layout [atlas.txt] [iterations]
+//
+// Both paths must produce the same vertices and bounds for characters the atlas has.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "glyph_table.hpp"
+
+namespace {
+// uv only depends on these through a division, any size works for timing
+constexpr int TEX_SIZE = 512;
+
+struct Atlas {
+    float em_size = 0;
+    std::vector<std::pair<int, Glyph>> glyphs;
+};
+
+bool load_atlas(const char *path, Atlas &atlas) {
+    std::ifstream in(path);
+    std::string label;
+    float value;
+
+    // distance_range, em_size, grid_width, grid_height
+    for (int i = 0; i < 4; i++) {
+        if (!(in >> label >> value)) {
+            return false;
+        }
+
+        if (label == "em_size") {
+            atlas.em_size = value;
+        }
+    }
+
+    in >> label;
+
+    int unicode;
+    Glyph g;
+    while (in >> unicode >> g.advance >> g.plane_left >> g.plane_bottom >> g.plane_right >> g.plane_top >>
+           g.atlas_left >> g.atlas_bottom >> g.atlas_right >> g.atlas_top) {
+        atlas.glyphs.emplace_back(unicode, g);
+    }
+
+    return !atlas.glyphs.empty();
+}
+
+// the layout as it was, a tree walk and the uv division per character, then a bbox pass
+GlyphBounds layout_map(std::map<int, Glyph> &glyph,
+                       float em_size,
+                       const std::string &str,
+                       std::vector<glm::vec4> &out) {
+    float xpos = 0;
+    float tw = static_cast<float>(TEX_SIZE);
+    float th = static_cast<float>(TEX_SIZE);
+
+    for (char ch : str) {
+        const Glyph &g = glyph[static_cast<int>(ch)];
+        glm::vec2 start{g.atlas_left / tw, 1 - g.atlas_bottom / th};
+        glm::vec2 end{g.atlas_right / tw, 1 - g.atlas_top / th};
+
+        float w = (g.atlas_right - g.atlas_left);
+        float h = (g.atlas_top - g.atlas_bottom);
+        float x = xpos + g.plane_left * em_size;
+        float y = std::abs(g.plane_bottom) * em_size;
+
+        out.push_back({x, y, start.x, start.y});
+        out.push_back({x + w, y, end.x, start.y});
+        out.push_back({x + w, y - h, end.x, end.y});
+        out.push_back({x, y - h, start.x, end.y});
+
+        xpos += g.advance * em_size;
+    }
+
+    GlyphBounds b{glm::vec2{out[0].x, out[0].y}, glm::vec2{out[0].x, out[0].y}};
+    for (const glm::vec4 &v : out) {
+        b.start = glm::vec2{std::min(b.start.x, v.x), std::min(b.start.y, v.y)};
+        b.end = glm::vec2{std::max(b.end.x, v.x), std::max(b.end.y, v.y)};
+    }
+
+    return b;
+}
+
+// the kernel precomputes x + width, so positions can differ in the last bits
+bool close(float a, float b) { return std::abs(a - b) <= 1e-5f * std::max(1.f, std::abs(a)); }
+
+bool same(const glm::vec4 &a, const glm::vec4 &b) {
+    return close(a.x, b.x) && close(a.y, b.y) && close(a.z, b.z) && close(a.w, b.w);
+}
+
+template <typename F>
+double time_ns_per_char(int iterations, size_t chars, F f) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+        f();
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(iterations) * static_cast<double>(chars));
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "assets/atlas.txt";
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    Atlas atlas;
+    if (!load_atlas(path, atlas)) {
+        printf("can't read %s\n", path);
+        return 1;
+    }
+
+    std::map<int, Glyph> glyph_map(atlas.glyphs.begin(), atlas.glyphs.end());
+    GlyphTable table;
+    table.build(atlas.glyphs, atlas.em_size, TEX_SIZE, TEX_SIZE);
+
+    std::string text;
+    while (text.size() < 10000) {
+        text += "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 ";
+    }
+
+    // the map inserted missing characters, keep to ones the atlas has so both agree
+    for (char &ch : text) {
+        if (!table.contains(static_cast<unsigned char>(ch))) {
+            ch = 'A';
+        }
+    }
+
+    bool ok = true;
+    std::vector<glm::vec4> a;
+    std::vector<glm::vec4> b(10000 * 4);
+    std::vector<uint32_t> glyph;
+
+    printf("%8s %14s %14s %8s\n", "glyphs", "map ns/glyph", "kernel ns/glyph", "speedup");
+
+    for (size_t n : {1, 100, 10000}) {
+        std::string t = text.substr(0, n);
+        GlyphBounds map_bounds;
+        GlyphBounds kernel_bounds;
+
+        a.reserve(n * 4);
+
+        double map_ns = time_ns_per_char(iterations, n, [&]() {
+            a.clear();
+            map_bounds = layout_map(glyph_map, atlas.em_size, t, a);
+        });
+
+        double kernel_ns = time_ns_per_char(iterations, n, [&]() {
+            glyph.clear();
+            table.lookup(t, glyph);
+
+            float pen = 0.f;
+            kernel_bounds = layout_quads(table, glyph.data(), n, 1.f, pen, b.data());
+        });
+
+        for (size_t i = 0; i < n * 4; i++) {
+            ok = ok && same(a[i], b[i]);
+        }
+
+        ok = ok && close(map_bounds.start.x, kernel_bounds.start.x) &&
+             close(map_bounds.start.y, kernel_bounds.start.y) && close(map_bounds.end.x, kernel_bounds.end.x) &&
+             close(map_bounds.end.y, kernel_bounds.end.y);
+
+        printf("%8zu %14.2f %14.2f %7.1fx\n", n, map_ns, kernel_ns, map_ns / kernel_ns);
+    }
+
+    if (!ok) {
+        printf("layouts differ\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Benchmark for src/tessellate.cpp, strokes and fills star polygons of 10 to 16k vertices.
+//
+//   bench_tessellate [iterations]
+//
+// The fill area is checked against the shoelace area so a broken triangulation shows up here too.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "tessellate.hpp"
+
+namespace {
+// concave star, alternating radius
+std::vector<glm::vec2> make_star(size_t n) {
+    std::vector<glm::vec2> pts;
+
+    for (size_t i = 0; i < n; i++) {
+        double theta = static_cast<double>(i) * 2.0 * M_PI / static_cast<double>(n);
+        double r = (i % 2) ? 0.5 : 1.0;
+        pts.push_back({static_cast<float>(r * std::cos(theta)), static_cast<float>(r * std::sin(theta))});
+    }
+
+    return pts;
+}
+
+double polygon_area(const std::vector<glm::vec2> &pts) {
+    double area = 0;
+
+    for (size_t i = 0; i < pts.size(); i++) {
+        const glm::vec2 &a = pts[i];
+        const glm::vec2 &b = pts[(i + 1) % pts.size()];
+        area += static_cast<double>(a.x) * b.y - static_cast<double>(a.y) * b.x;
+    }
+
+    return std::abs(area) * 0.5;
+}
+
+double triangle_area(const TessArena &arena, const TessRange &range) {
+    double area = 0;
+
+    for (uint32_t i = range.first_index; i < range.first_index + range.index_count; i += 3) {
+        const glm::vec2 &a = arena.vertex[arena.index[i]];
+        const glm::vec2 &b = arena.vertex[arena.index[i + 1]];
+        const glm::vec2 &c = arena.vertex[arena.index[i + 2]];
+        area += std::abs(static_cast<double>(b.x - a.x) * (c.y - a.y) - static_cast<double>(b.y - a.y) * (c.x - a.x));
+    }
+
+    return area * 0.5;
+}
+
+template <typename F>
+double time_us(int iterations, F f) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+        f();
+    }
+
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+    bool ok = true;
+
+    printf("%8s %12s %12s %12s %12s %10s\n", "vertices", "miter us", "bevel us", "round us", "fill us", "fill err");
+
+    TessArena arena;
+
+    for (size_t n : {10, 100, 1000, 4000, 16000}) {
+        std::vector<glm::vec2> star = make_star(n);
+
+        double us[3];
+        LineJoin joins[3] = {LineJoin::miter, LineJoin::bevel, LineJoin::round};
+
+        for (int j = 0; j < 3; j++) {
+            StrokeStyle style;
+            style.width = 0.01f;
+            style.join = joins[j];
+
+            us[j] = time_us(iterations, [&]() {
+                arena.clear();
+                stroke_polyline(arena, star.data(), star.size(), style);
+            });
+        }
+
+        TessRange range;
+        double fill_us = time_us(iterations, [&]() {
+            arena.clear();
+            range = fill_polygon(arena, star.data(), star.size());
+        });
+
+        double expected = polygon_area(star);
+        double err = std::abs(triangle_area(arena, range) - expected) / expected;
+
+        if (range.index_count != (n - 2) * 3 || err > 1e-3) {
+            ok = false;
+        }
+
+        printf("%8zu %12.1f %12.1f %12.1f %12.1f %10.2e\n", n, us[0], us[1], us[2], fill_us, err);
+    }
+
+    if (!ok) {
+        printf("fill produced the wrong triangles\n");
+        return 1;
+    }
+
+    return 0;
+}
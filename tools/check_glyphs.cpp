@@ -0,0 +1,271 @@
+// Checks the run time glyph path against a TrueType font: cmap lookup and outlines, the sign of the
+// generated MSDF, SkylinePacker packing until full and again after a reset, GlyphCache evicting its least
+// recently used page and next_utf8 on valid and malformed input.
+//
+//   check_glyphs assets/font.ttf
+//
+// Page textures are kept in memory instead of GL, so no context is needed. Exits with 1 if any check fails.
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "glyph_cache.hpp"
+#include "vfs.hpp"
+
+namespace {
+constexpr uint64_t WAIT_NS = 5 * SDL_NS_PER_SECOND;
+
+struct Rect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+// every upload of each stand-in texture, indexed by Texture::id
+std::vector<std::vector<Rect>> uploads;
+
+bool overlap(const Rect &a, const Rect &b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += ok ? 0 : 1;
+}
+
+void check_utf8() {
+    struct Case {
+        const char *name;
+        std::string str;
+        std::vector<uint32_t> expected;
+    };
+
+    const std::vector<Case> cases{
+        {"ascii", "Ab", {0x41, 0x62}},
+        {"two bytes", "\xC3\xA9", {0xE9}},
+        {"three bytes", "\xE2\x82\xAC", {0x20AC}},
+        {"four bytes", "\xF0\x9F\x98\x80", {0x1F600}},
+        {"overlong", "\xC0\xAF", {0xFFFD, 0xFFFD}},
+        {"surrogate", "\xED\xA0\x80", {0xFFFD, 0xFFFD, 0xFFFD}},
+        {"truncated", "\xE2\x82", {0xFFFD, 0xFFFD}},
+        {"stray continuation", "\x80" "A", {0xFFFD, 0x41}},
+        {"past U+10FFFF", "\xF4\x90\x80\x80", {0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD}},
+    };
+
+    for (const Case &c : cases) {
+        std::vector<uint32_t> decoded;
+
+        for (size_t i = 0; i < c.str.size();) {
+            decoded.push_back(next_utf8(c.str, i));
+        }
+
+        check(decoded == c.expected, (std::string("next_utf8 ") + c.name).c_str());
+    }
+}
+
+void check_font(const TrueTypeFont &font) {
+    uint32_t h = font.glyph_index('H');
+    GlyphOutline outline;
+
+    check(h != 0, "cmap maps 'H'");
+    check(font.outline(h, outline) && !outline.contours.empty(), "'H' has contours");
+    check(outline.advance > 0.f && outline.max.x > outline.min.x, "'H' has an advance and a bounding box");
+
+    GlyphOutline space;
+    check(font.outline(font.glyph_index(' '), space) && space.contours.empty(), "' ' has no contours");
+}
+
+void check_msdf(const GlyphCache &gc) {
+    GlyphCache::Bitmap b = gc.render('I');
+
+    if (b.width == 0) {
+        check(false, "'I' renders a bitmap");
+        return;
+    }
+
+    auto median = [&](int x, int y) {
+        size_t i = static_cast<size_t>(y) * static_cast<size_t>(b.width) + static_cast<size_t>(x);
+        const uint8_t *p = &b.rgb[i * 3];
+        return std::max(std::min(p[0], p[1]), std::min(std::max(p[0], p[1]), p[2]));
+    };
+
+    // the padding is outside, the middle of the stem inside
+    check(median(0, 0) < 128 && median(b.width - 1, b.height - 1) < 128, "MSDF corners are outside");
+    check(median(b.width / 2, b.height / 2) > 128, "MSDF stem center is inside");
+}
+
+void check_packer() {
+    SkylinePacker packer;
+    packer.reset(256, 256);
+
+    uint32_t seed = 1;
+    auto next_size = [&]() {
+        seed = seed * 1664525 + 1013904223;
+        return 8 + static_cast<int>(seed >> 27);
+    };
+
+    std::vector<Rect> packed;
+    bool in_bounds = true;
+    bool disjoint = true;
+
+    while (true) {
+        Rect r{0, 0, next_size(), next_size()};
+
+        if (!packer.pack(r.w, r.h, r.x, r.y)) {
+            break;
+        }
+
+        in_bounds = in_bounds && r.x >= 0 && r.y >= 0 && r.x + r.w <= 256 && r.y + r.h <= 256;
+
+        for (const Rect &o : packed) {
+            disjoint = disjoint && !overlap(r, o);
+        }
+
+        packed.push_back(r);
+    }
+
+    check(packed.size() > 50, "skyline packs a 256x256 page");
+    check(in_bounds, "skyline rects stay on the page");
+    check(disjoint, "skyline rects don't overlap");
+
+    // eviction resets the packer, the page must pack like a new one
+    packer.reset(256, 256);
+    seed = 1;
+    bool same = true;
+
+    for (const Rect &p : packed) {
+        Rect r{0, 0, next_size(), next_size()};
+        same = same && packer.pack(r.w, r.h, r.x, r.y) && r.x == p.x && r.y == p.y;
+    }
+
+    check(same, "skyline packs the same way after a reset");
+}
+
+// Lays str out every frame until every glyph is there, false on timeout.
+bool wait_for(GlyphCache &gc, const std::string &str) {
+    GlyphTable no_atlas;
+    std::vector<glm::vec4> atlas_vertex_uv;
+    std::vector<std::vector<glm::vec4>> page_vertex_uv;
+    uint64_t start = SDL_GetTicksNS();
+
+    while (SDL_GetTicksNS() - start < WAIT_NS) {
+        page_vertex_uv.clear();
+
+        if (gc.layout(str, no_atlas, 1.f, atlas_vertex_uv, page_vertex_uv)) {
+            gc.update();
+            return true;
+        }
+
+        gc.update();
+        SDL_Delay(1);
+    }
+
+    return false;
+}
+
+void check_eviction(Vfs &vfs, const std::string &name) {
+    // big glyphs on a single page, a few letters fill it
+    GlyphCache gc;
+    gc.max_pages = 1;
+
+    if (!gc.init(vfs, name, 240.f, 8)) {
+        check(false, "glyph cache starts");
+        return;
+    }
+
+    check(wait_for(gc, "ABCD"), "glyphs are generated");
+    check(gc.evictions == 0 && gc.pages.size() == 1, "the first letters fit one page");
+
+    bool done = true;
+
+    for (char ch = 'E'; ch <= 'Z'; ch++) {
+        done = done && wait_for(gc, std::string(1, ch));
+    }
+
+    check(done, "glyphs are generated while pages are evicted");
+    check(gc.evictions > 0 && gc.generation == gc.evictions, "a full cache evicts");
+
+    // only what was placed before the last eviction goes
+    const GlyphCache::Entry *z = gc.get('Z');
+    check(z && z->page == 0, "the newest glyph stays cached");
+
+    // 'A' went with the first eviction and comes back on its next use
+    check(!gc.get('A') && wait_for(gc, "A"), "an evicted glyph is generated again");
+
+    bool uploads_disjoint = true;
+
+    for (const std::vector<Rect> &tex : uploads) {
+        for (size_t i = 0; i < tex.size(); i++) {
+            for (size_t j = i + 1; j < tex.size(); j++) {
+                // texels are reused only after a reset, which starts over at the origin
+                if (tex[j].x == 0 && tex[j].y == 0) {
+                    break;
+                }
+
+                uploads_disjoint = uploads_disjoint && !overlap(tex[i], tex[j]);
+            }
+        }
+    }
+
+    check(uploads_disjoint, "uploads between evictions don't overlap");
+
+    gc.shutdown();
+}
+}  // namespace
+
+// in memory stand-ins for the GL side of gl_helper, all the cache uses
+TexturePtr make_texture(int width, int height) {
+    TexturePtr tex(new Texture, [](Texture *t) { delete t; });
+    tex->id = static_cast<GLuint>(uploads.size());
+    tex->width = width;
+    tex->height = height;
+    uploads.emplace_back();
+    return tex;
+}
+
+void update_texture(const Texture &tex, int x, int y, int width, int height, const uint8_t *rgb) {
+    (void)rgb;
+
+    if (x < 0 || y < 0 || x + width > tex.width || y + height > tex.height) {
+        check(false, "upload stays inside the page");
+    }
+
+    uploads[tex.id].push_back(Rect{x, y, width, height});
+}
+
+int main(int argc, char *argv[]) {
+    std::string path = argc > 1 ? argv[1] : "assets/font.ttf";
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    check_utf8();
+    check_packer();
+
+    Vfs vfs;
+    vfs.mount(dir + "/");
+
+    GlyphCache gc;
+
+    if (!gc.init(vfs, name, 32.f, 4)) {
+        printf("can't load %s\n", path.c_str());
+        return 1;
+    }
+
+    gc.shutdown();
+
+    check_font(gc.font);
+    check_msdf(gc);
+    check_eviction(vfs, name);
+
+    printf("%d checks failed\n", failures);
+
+    return failures > 0 ? 1 : 0;
+}